@@ -10,7 +10,46 @@
 ================================================================*/
 
 #include "Json.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <condition_variable>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <iterator>
+#include <limits>
+#include <locale>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <system_error>
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define MINIJSON_X86_SIMD
+    #include <emmintrin.h>
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #endif
+#endif
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
 
 // to prevent header corruption
 namespace xuranus {
@@ -36,19 +75,29 @@ class JsonScanner {
         };
 
     public:
-        JsonScanner(const std::string &str);
+        JsonScanner(const char* data, std::size_t length);
         void Reset();
         Token Next();
         double GetDoubleValue() const;
         int64_t GetLongIntValue() const;
         bool IsNumberLongInt() const;
-        std::string GetStringValue() const;
+        const std::string& GetStringValue() const;
+        /**
+         * classify the whole input once so that whitespace runs are skipped with a single index lookup.
+         * the index is only consulted when a token starts on whitespace, the token bodies are still scanned
+         * char by char: jumping straight to the next indexed position would step over trailing garbage such
+         * as the "x" of "truex", which the plain scanner rejects
+         */
+        void UseStructuralIndex(bool enable);
         inline void RollBack() { m_pos = m_prevPos; }
         inline size_t Position() { return m_pos; }
+        inline const char* Data() const { return m_data; }
+        inline std::size_t Length() const { return m_length; }
         static std::string TokenName(Token token);
 
     private:  
         void ScanNextString();
+        uint32_t ScanHex4();
         void ScanNextNumber();
 
         inline bool IsWhiltespaceToken(char ch)
@@ -63,22 +112,29 @@ class JsonScanner {
         
         inline bool SkipWhitespaceToken()
         {
-            while(m_pos < m_str.size() && IsWhiltespaceToken(m_str[m_pos])) {
+            if (m_useStructuralIndex && m_pos < m_length && IsWhiltespaceToken(m_data[m_pos])) {
+                return SkipToNextStructural();
+            }
+            while(m_pos < m_length && IsWhiltespaceToken(m_data[m_pos])) {
                 m_pos++;
             }
-            return m_pos < m_str.size();
+            return m_pos < m_length;
         }
 
-        inline void ScanLiteral(const std::string& literal, int offset)
+        inline void ScanLiteral(const char* literal, std::size_t offset)
         {
-            if (m_str.compare(m_pos, offset, literal) == 0) {
+            if (m_pos + offset <= m_length && std::memcmp(m_data + m_pos, literal, offset) == 0) {
                 m_pos += offset;
             } else {
-                Panic("unknown literal token at position = %lu, do you mean: %s ?", m_pos, literal.c_str());
+                Panic("unknown literal token at position = %lu, do you mean: %s ?", m_pos, literal);
             }
         }
+        bool SkipToNextStructural();
+
     private:
-        std::string m_str;
+        // caller owned buffer, scanned in place and never copied
+        const char* m_data { nullptr };
+        std::size_t m_length = 0;
         std::size_t m_pos = 0;
         std::size_t m_prevPos = 0;
 
@@ -87,11 +143,198 @@ class JsonScanner {
         int64_t m_tmpNumberLongValue {0};
         bool m_int64Number { true };
         std::map<char, char> m_escapeMap {};
+
+        // positions of structural characters, opening quotes and scalar starts outside of strings
+        std::vector<uint32_t> m_structurals {};
+        std::size_t m_structuralCursor = 0;
+        bool m_useStructuralIndex { false };
+};
+
+// read-only view of a whole file, memory mapped when possible and read into a buffer otherwise (pipes, sockets...)
+class FileBuffer {
+    public:
+        explicit FileBuffer(const std::string& path);
+        FileBuffer(const FileBuffer&) = delete;
+        FileBuffer& operator = (const FileBuffer&) = delete;
+        ~FileBuffer();
+        inline const char* Data() const { return m_mapped != nullptr ? m_mapped : m_buffer.data(); }
+        inline std::size_t Size() const { return m_mapped != nullptr ? m_mappedSize : m_buffer.size(); }
+
+    private:
+        const char* m_mapped { nullptr };
+        std::size_t m_mappedSize = 0;
+        std::string m_buffer {};
+};
+
+// bump allocator, memory is only given back all at once by Reset() or the destructor
+class JsonArena {
+    public:
+        explicit JsonArena(std::size_t blockSize = 64 * 1024);
+        JsonArena(const JsonArena&) = delete;
+        JsonArena& operator = (const JsonArena&) = delete;
+        ~JsonArena();
+        void* Allocate(std::size_t size, std::size_t alignment);
+        const char* CopyString(const char* str, std::size_t length);
+        // rewind to the first block, all blocks are kept for reuse
+        void Reset();
+        std::size_t Capacity() const;
+
+    private:
+        struct Block {
+            char* data;
+            std::size_t size;
+        };
+        std::vector<Block> m_blocks {};
+        std::size_t m_current = 0; // index of the block being filled
+        std::size_t m_offset = 0; // first free byte of the current block
+        std::size_t m_blockSize;
+};
+
+// set of distinct keys copied once into the arena, lookups by content return the shared copy
+class JsonKeyPool {
+    public:
+        explicit JsonKeyPool(JsonArena& arena);
+        const char* Intern(const char* key, std::size_t length);
+        // nullptr if the key has not been interned
+        const char* Find(const char* key, std::size_t length) const;
+        // forget all keys, called whenever the arena is reset
+        void Clear();
+
+    private:
+        struct Entry {
+            const char* key;
+            std::size_t length;
+        };
+        // slot holding the key, or the empty slot where it would be inserted
+        std::size_t Probe(const char* key, std::size_t length) const;
+        void Grow();
+
+    private:
+        static const char EMPTY_KEY[1];
+        JsonArena& m_arena;
+        std::vector<Entry> m_entries {}; // open addressing, power of two size, nullptr key marks an empty slot
+        std::size_t m_size = 0;
+        bool m_hasEmptyKey { false }; // the empty key is not stored in m_entries
+};
+
+// build the JsonNode tree of a JsonDocument, children are collected on reusable stacks then copied into the arena
+class JsonDocumentBuilder {
+    public:
+        // keys are interned when keys is not nullptr
+        JsonDocumentBuilder(JsonScanner& scanner, JsonArena& arena, JsonKeyPool* keys = nullptr);
+        void Build(JsonNode& root);
+
+    private:
+        void ParseNext(JsonNode& node);
+        void ParseJsonObject(JsonNode& node);
+        void ParseJsonArray(JsonNode& node);
+        void EnterContainer();
+
+    private:
+        JsonScanner& m_scanner;
+        JsonArena& m_arena;
+        JsonKeyPool* m_keys;
+        std::vector<JsonNode> m_elementStack {};
+        std::vector<JsonMember> m_memberStack {};
+        std::size_t m_depth = 0; // open containers, capped at JsonParser::MAX_DEPTH like the parser
+};
+
+// grammar of JsonParser checked in one iterative pass, nothing is allocated and nothing throws
+class JsonValidator {
+    public:
+        JsonValidator(const char* data, std::size_t length);
+        bool Validate(JsonError& error);
+
+    private:
+        bool Fail(JsonErrorCode code, std::size_t offset);
+        bool SkipString();
+        bool SkipNumber();
+        bool SkipLiteral(const char* literal, std::size_t length);
+        bool ScanHex4(uint32_t& value);
+        void Push(bool isObject);
+        bool Pop(); // return whether the new innermost container is an object
+
+        inline bool IsDigit(char ch)
+        {
+            return '0' <= ch && ch <= '9';
+        }
+
+        inline void SkipWhitespace()
+        {
+            while (m_pos < m_length && (m_data[m_pos] == ' ' || m_data[m_pos] == '\n'
+                || m_data[m_pos] == '\r' || m_data[m_pos] == '\t')) {
+                m_pos++;
+            }
+        }
+
+    private:
+        const char* m_data { nullptr };
+        std::size_t m_length = 0;
+        std::size_t m_pos = 0;
+        JsonError* m_error { nullptr };
+        // one bit per open container, set for objects
+        uint64_t m_stack[(JsonParser::MAX_DEPTH + 63) / 64] {};
+        std::size_t m_depth = 0;
+};
+
+// assemble JsonElement values from handler events, used by JsonPushParser
+class JsonElementBuilder : public JsonHandler {
+    public:
+        bool StartObject() override;
+        bool Key(const char* key, std::size_t length) override;
+        bool EndObject(std::size_t memberCount) override;
+        bool StartArray() override;
+        bool EndArray(std::size_t elementCount) override;
+        bool String(const char* str, std::size_t length) override;
+        bool Int64(int64_t value) override;
+        bool Double(double value) override;
+        bool Bool(bool value) override;
+        bool Null() override;
+
+        JsonElement& Root();
+        void Reset();
+
+    private:
+        bool Add(JsonElement&& element);
+        bool EndContainer();
+
+    private:
+        std::vector<JsonElement> m_stack {}; // open containers
+        std::vector<std::string> m_keys {}; // pending member keys of the open objects
+        JsonElement m_root {};
 };
 
 namespace util {
+    // stage one of the scanner: SIMD classification of the input into structural positions (simdjson style)
+    void BuildStructuralIndex(const char* data, std::size_t length, std::vector<uint32_t>& structurals);
     std::string EscapeString(const std::string& str);
-    std::string UnescapeString(const std::string& str);
+    // append str escaped, without the surrounding quotes
+    void AppendEscapedString(std::string& out, const char* str, std::size_t length);
+    // position of the first quote or backslash in [pos, length), length if there is none
+    std::size_t FindQuoteOrBackslash(const char* data, std::size_t pos, std::size_t length);
+    void AppendUtf8(std::string& str, uint32_t codePoint);
+    std::size_t SkipWhitespace(const char* data, std::size_t pos, std::size_t length);
+    // position right after the value starting at data[pos], containers are skipped by bracket matching
+    std::size_t SkipValue(const char* data, std::size_t pos, std::size_t length);
+    /**
+     * scan the json number starting at data[pos] in place and move pos past it, return false if it is malformed.
+     * integers are accumulated with overflow detection and promoted to double when they do not fit in int64,
+     * floats go through the Clinger and Eisel-Lemire fast paths, with a locale independent fallback
+     */
+    bool ScanNumber(const char* data, std::size_t length, std::size_t& pos,
+        bool& isLongInt, int64_t& longValue, double& doubleValue);
+    // nearest double of mantissa * 10^exponent10, return false when the fast paths can not decide
+    bool DecimalToDouble(uint64_t mantissa, int64_t exponent10, bool negative, double& value);
+    // truncate toward zero like static_cast, but panic on NaN and values outside int64_t instead of undefined behavior
+    int64_t DoubleToLongInt(double value);
+    // enough for the longest output of FormatDouble and FormatLongInt
+    const std::size_t MAX_NUMBER_LENGTH = 32;
+    /**
+     * write the shortest decimal that parses back to the same double (Grisu2) into buffer, return its length.
+     * formatted like ECMAScript Number.prototype.toString, NaN and infinity have no json form and are written as null
+     */
+    std::size_t FormatDouble(double value, char* buffer);
+    std::size_t FormatLongInt(int64_t value, char* buffer);
     std::string DoubleToString(double value);
     std::string LongIntToString(int64_t value);
 }
@@ -104,14 +347,16 @@ using namespace xuranus::minijson::util;
 
 // implement start from here
 
+static_assert(sizeof(JsonElement) == 16, "JsonElement is expected to stay 16 bytes");
+
 JsonElement::JsonElement()
 {
-    m_type = JsonElement::Type::JSON_NULL;
+    m_value.tag.type = JsonElement::Type::JSON_NULL;
 }
 
 JsonElement::JsonElement(JsonElement::Type type)
 {
-    m_type = type;
+    m_value.tag.type = type;
     switch (type) {
         case JsonElement::Type::JSON_OBJECT: {
             m_value.objectValue = new JsonObject();
@@ -122,7 +367,7 @@ JsonElement::JsonElement(JsonElement::Type type)
             break;
         }
         case JsonElement::Type::JSON_STRING: {
-            m_value.stringValue = new std::string();
+            SetString("", 0);
             break;
         }
         case JsonElement::Type::JSON_NUMBER_LONG: {
@@ -143,46 +388,71 @@ JsonElement::JsonElement(JsonElement::Type type)
     }
 }
 
-JsonElement::JsonElement(bool value): m_type(JsonElement::Type::JSON_BOOL)
+JsonElement::JsonElement(bool value)
 {
+    m_value.tag.type = JsonElement::Type::JSON_BOOL;
     m_value.boolValue = value;
 }
 
-JsonElement::JsonElement(double num): m_type(JsonElement::Type::JSON_NUMBER_DOUBLE)
+JsonElement::JsonElement(double num)
 {
+    m_value.tag.type = JsonElement::Type::JSON_NUMBER_DOUBLE;
     m_value.numberDoubleValue = num;
 }
 
-JsonElement::JsonElement(int64_t num): m_type(JsonElement::Type::JSON_NUMBER_LONG)
+JsonElement::JsonElement(int64_t num)
 {
+    m_value.tag.type = JsonElement::Type::JSON_NUMBER_LONG;
     m_value.numberLongValue = num;
 }
 
-JsonElement::JsonElement(const std::string &str): m_type(JsonElement::Type::JSON_STRING)
+JsonElement::JsonElement(const std::string &str)
 {
-    m_value.stringValue = new std::string(str);
+    m_value.tag.type = JsonElement::Type::JSON_STRING;
+    SetString(str.data(), str.size());
 }
 
-JsonElement::JsonElement(char const *str): m_type(JsonElement::Type::JSON_STRING)
+JsonElement::JsonElement(std::string &&str)
 {
-    m_value.stringValue = new std::string(str);
+    m_value.tag.type = JsonElement::Type::JSON_STRING;
+    SetString(std::move(str));
 }
 
-JsonElement::JsonElement(const JsonObject& object): m_type(JsonElement::Type::JSON_OBJECT)
+JsonElement::JsonElement(char const *str)
 {
+    m_value.tag.type = JsonElement::Type::JSON_STRING;
+    SetString(str, std::strlen(str));
+}
+
+JsonElement::JsonElement(const JsonObject& object)
+{
+    m_value.tag.type = JsonElement::Type::JSON_OBJECT;
     m_value.objectValue = new JsonObject(object);
 }
 
-JsonElement::JsonElement(const JsonArray& array): m_type(JsonElement::Type::JSON_ARRAY)
+JsonElement::JsonElement(JsonObject&& object)
+{
+    m_value.tag.type = JsonElement::Type::JSON_OBJECT;
+    m_value.objectValue = new JsonObject(std::move(object));
+}
+
+JsonElement::JsonElement(const JsonArray& array)
 {
-    m_value.arrayValue = new JsonArray(array);;
+    m_value.tag.type = JsonElement::Type::JSON_ARRAY;
+    m_value.arrayValue = new JsonArray(array);
 }
 
+JsonElement::JsonElement(JsonArray&& array)
+{
+    m_value.tag.type = JsonElement::Type::JSON_ARRAY;
+    m_value.arrayValue = new JsonArray(std::move(array));
+}
 
 
-JsonElement::JsonElement(const JsonElement& ele): m_type(ele.m_type)
+JsonElement::JsonElement(const JsonElement& ele)
 {
-    switch (ele.m_type) {
+    m_value.tag.type = ele.m_value.tag.type;
+    switch (ele.m_value.tag.type) {
         case JsonElement::Type::JSON_OBJECT: {
             m_value.objectValue = new JsonObject(*ele.m_value.objectValue);
             break;
@@ -192,7 +462,7 @@ JsonElement::JsonElement(const JsonElement& ele): m_type(ele.m_type)
             break;
         }
         case JsonElement::Type::JSON_STRING: {
-            m_value.stringValue = new std::string(*ele.m_value.stringValue);
+            SetString(ele.StringData(), ele.StringLength());
             break;
         }
         case JsonElement::Type::JSON_NUMBER_LONG: {
@@ -213,40 +483,11 @@ JsonElement::JsonElement(const JsonElement& ele): m_type(ele.m_type)
     }
 }
 
-JsonElement::JsonElement(JsonElement&& ele): m_type(ele.m_type)
+JsonElement::JsonElement(JsonElement&& ele) noexcept : m_value(ele.m_value)
 {
-    switch (ele.m_type) {
-        case JsonElement::Type::JSON_OBJECT: {
-            m_value.objectValue = ele.m_value.objectValue;
-            ele.m_value.objectValue = nullptr;
-            break;
-        }
-        case JsonElement::Type::JSON_ARRAY: {
-            m_value.arrayValue = ele.m_value.arrayValue;
-            ele.m_value.arrayValue = nullptr;
-            break;
-        }
-        case JsonElement::Type::JSON_STRING: {
-            m_value.stringValue = ele.m_value.stringValue;
-            ele.m_value.stringValue = nullptr;
-            break;
-        }
-        case JsonElement::Type::JSON_NUMBER_LONG: {
-            m_value.numberLongValue = ele.m_value.numberLongValue;
-            break;
-        }
-        case JsonElement::Type::JSON_NUMBER_DOUBLE: {
-            m_value.numberDoubleValue = ele.m_value.numberDoubleValue;
-            break;
-        }
-        case JsonElement::Type::JSON_BOOL: {
-            m_value.boolValue = ele.m_value.boolValue;
-            break;
-        }
-        case JsonElement::Type::JSON_NULL: {
-            break;
-        }
-    }
+    // heap values are owned by this element from now on
+    ele.m_value = Value {};
+    ele.m_value.tag.type = JsonElement::Type::JSON_NULL;
 }
 
 JsonElement& JsonElement::operator = (const JsonElement& ele)
@@ -254,30 +495,9 @@ JsonElement& JsonElement::operator = (const JsonElement& ele)
     if (this == &ele) {
         return *this;
     }
-    switch (m_type) {
-        case JsonElement::Type::JSON_OBJECT: {
-            delete m_value.objectValue;
-            m_value.objectValue = nullptr;
-            break;
-        }
-        case JsonElement::Type::JSON_ARRAY: {
-            delete m_value.arrayValue;
-            m_value.arrayValue = nullptr;
-            break;
-        }
-        case JsonElement::Type::JSON_STRING: {
-            delete m_value.stringValue;
-            m_value.stringValue = nullptr;
-            break;
-        }
-        case JsonElement::Type::JSON_NUMBER_DOUBLE:
-        case JsonElement::Type::JSON_NUMBER_LONG:
-        case JsonElement::Type::JSON_BOOL:
-        case JsonElement::Type::JSON_NULL:
-            break;
-    }
-    m_type = ele.m_type;
-    switch (ele.m_type) {
+    Release();
+    m_value.tag.type = ele.m_value.tag.type;
+    switch (ele.m_value.tag.type) {
         case JsonElement::Type::JSON_OBJECT: {
             m_value.objectValue = new JsonObject(*ele.m_value.objectValue);
             break;
@@ -287,7 +507,7 @@ JsonElement& JsonElement::operator = (const JsonElement& ele)
             break;
         }
         case JsonElement::Type::JSON_STRING: {
-            m_value.stringValue = new std::string(*ele.m_value.stringValue);
+            SetString(ele.StringData(), ele.StringLength());
             break;
         }
         case JsonElement::Type::JSON_NUMBER_LONG: {
@@ -309,10 +529,29 @@ JsonElement& JsonElement::operator = (const JsonElement& ele)
     return *this;
 }
 
+JsonElement& JsonElement::operator = (JsonElement&& ele) noexcept
+{
+    if (this == &ele) {
+        return *this;
+    }
+    // detach the value first, ele may be owned by the value released below
+    Value value = ele.m_value;
+    ele.m_value = Value {};
+    ele.m_value.tag.type = JsonElement::Type::JSON_NULL;
+    Release();
+    m_value = value;
+    return *this;
+}
 
 JsonElement::~JsonElement()
 {
-    switch (m_type) {
+    Release();
+}
+
+// free the heap value, m_value is left dangling and must be overwritten or discarded
+void JsonElement::Release()
+{
+    switch (m_value.tag.type) {
         case JsonElement::Type::JSON_OBJECT: {
             delete m_value.objectValue;
             m_value.objectValue = nullptr;
@@ -324,8 +563,10 @@ JsonElement::~JsonElement()
             break;
         }
         case JsonElement::Type::JSON_STRING: {
-            delete m_value.stringValue;
-            m_value.stringValue = nullptr;
+            if (!IsInlineString()) {
+                delete m_value.stringValue;
+                m_value.stringValue = nullptr;
+            }
             break;
         }
         case JsonElement::Type::JSON_NUMBER_LONG:
@@ -338,7 +579,7 @@ JsonElement::~JsonElement()
 
 bool& JsonElement::AsBool()
 {
-    if (m_type != JsonElement::Type::JSON_BOOL) {
+    if (m_value.tag.type != JsonElement::Type::JSON_BOOL) {
         Panic("failed to convert json element %s as a bool", TypeName().c_str());
     }
     return m_value.boolValue;
@@ -346,7 +587,7 @@ bool& JsonElement::AsBool()
 
 double& JsonElement::AsDouble()
 {
-    if (m_type != JsonElement::Type::JSON_NUMBER_DOUBLE) {
+    if (m_value.tag.type != JsonElement::Type::JSON_NUMBER_DOUBLE) {
         Panic("failed to convert json element %s as a double", TypeName().c_str());
     }
     return m_value.numberDoubleValue;
@@ -354,7 +595,7 @@ double& JsonElement::AsDouble()
 
 int64_t& JsonElement::AsLongInt()
 {
-    if (m_type != JsonElement::Type::JSON_NUMBER_LONG) {
+    if (m_value.tag.type != JsonElement::Type::JSON_NUMBER_LONG) {
         Panic("failed to convert json element %s as a long int", TypeName().c_str());
     }
     return m_value.numberLongValue;
@@ -362,7 +603,7 @@ int64_t& JsonElement::AsLongInt()
 
 void* JsonElement::AsNull() const
 {
-    if (m_type != JsonElement::Type::JSON_NULL) {
+    if (m_value.tag.type != JsonElement::Type::JSON_NULL) {
         Panic("failed to convert json element %s as a null", TypeName().c_str());
     }
     return nullptr;
@@ -370,15 +611,20 @@ void* JsonElement::AsNull() const
 
 std::string& JsonElement::AsString()
 {
-    if (m_type != JsonElement::Type::JSON_STRING) {
+    if (m_value.tag.type != JsonElement::Type::JSON_STRING) {
         Panic("failed to convert json element %s as a string", TypeName().c_str());
     }
+    if (IsInlineString()) {
+        std::string* str = new std::string(m_value.inlineString, m_value.tag.inlineStringLength);
+        m_value.stringValue = str;
+        m_value.tag.inlineStringLength = HEAP_STRING;
+    }
     return *(m_value.stringValue);
 }
 
 JsonObject& JsonElement::AsJsonObject()
 {
-    if (m_type != JsonElement::Type::JSON_OBJECT) {
+    if (m_value.tag.type != JsonElement::Type::JSON_OBJECT) {
         Panic("failed to convert json element %s as an object", TypeName().c_str());
     }
     return *(m_value.objectValue);
@@ -386,7 +632,7 @@ JsonObject& JsonElement::AsJsonObject()
 
 JsonArray& JsonElement::AsJsonArray()
 {
-    if (m_type != JsonElement::Type::JSON_ARRAY) {
+    if (m_value.tag.type != JsonElement::Type::JSON_ARRAY) {
         Panic("failed to convert json element %s as an array", TypeName().c_str());
     }
     return *(m_value.arrayValue);
@@ -396,7 +642,7 @@ JsonArray& JsonElement::AsJsonArray()
 
 bool JsonElement::ToBool() const
 {
-    if (m_type != JsonElement::Type::JSON_BOOL) {
+    if (m_value.tag.type != JsonElement::Type::JSON_BOOL) {
         Panic("failed to convert json element %s as a bool", TypeName().c_str());
     }
     return m_value.boolValue;
@@ -404,23 +650,29 @@ bool JsonElement::ToBool() const
 
 double JsonElement::ToDouble() const
 {
-    if (m_type != JsonElement::Type::JSON_NUMBER_LONG && m_type != JsonElement::Type::JSON_NUMBER_DOUBLE) {
+    if (m_value.tag.type == JsonElement::Type::JSON_NUMBER_LONG) {
+        return static_cast<double>(m_value.numberLongValue);
+    }
+    if (m_value.tag.type != JsonElement::Type::JSON_NUMBER_DOUBLE) {
         Panic("failed to convert json element %s as a double", TypeName().c_str());
     }
-    return static_cast<double>(m_value.numberDoubleValue);
+    return m_value.numberDoubleValue;
 }
 
 int64_t JsonElement::ToLongInt() const
 {
-    if (m_type != JsonElement::Type::JSON_NUMBER_LONG && m_type != JsonElement::Type::JSON_NUMBER_DOUBLE) {
+    if (m_value.tag.type == JsonElement::Type::JSON_NUMBER_DOUBLE) {
+        return util::DoubleToLongInt(m_value.numberDoubleValue);
+    }
+    if (m_value.tag.type != JsonElement::Type::JSON_NUMBER_LONG) {
         Panic("failed to convert json element %s as a long int", TypeName().c_str());
     }
-    return static_cast<int64_t>(m_value.numberLongValue);
+    return m_value.numberLongValue;
 }
 
 void* JsonElement::ToNull() const
 {
-    if (m_type != JsonElement::Type::JSON_NULL) {
+    if (m_value.tag.type != JsonElement::Type::JSON_NULL) {
         Panic("failed to convert json element %s as a null", TypeName().c_str());
     }
     return nullptr;
@@ -428,15 +680,53 @@ void* JsonElement::ToNull() const
 
 std::string JsonElement::ToString() const
 {
-    if (m_type != JsonElement::Type::JSON_STRING) {
+    if (m_value.tag.type != JsonElement::Type::JSON_STRING) {
         Panic("failed to convert json element %s as a string", TypeName().c_str());
     }
-    return *(m_value.stringValue);
+    return std::string(StringData(), StringLength());
+}
+
+void JsonElement::SetString(const char* str, std::size_t length)
+{
+    if (length <= INLINE_STRING_CAPACITY) {
+        if (length != 0) {
+            std::memcpy(m_value.inlineString, str, length);
+        }
+        m_value.tag.inlineStringLength = static_cast<uint8_t>(length);
+    } else {
+        m_value.stringValue = new std::string(str, length);
+        m_value.tag.inlineStringLength = HEAP_STRING;
+    }
+}
+
+void JsonElement::SetString(std::string&& str)
+{
+    if (str.size() <= INLINE_STRING_CAPACITY) {
+        SetString(str.data(), str.size());
+    } else {
+        m_value.stringValue = new std::string(std::move(str));
+        m_value.tag.inlineStringLength = HEAP_STRING;
+    }
+}
+
+bool JsonElement::IsInlineString() const
+{
+    return m_value.tag.inlineStringLength != HEAP_STRING;
+}
+
+const char* JsonElement::StringData() const
+{
+    return IsInlineString() ? m_value.inlineString : m_value.stringValue->data();
+}
+
+std::size_t JsonElement::StringLength() const
+{
+    return IsInlineString() ? m_value.tag.inlineStringLength : m_value.stringValue->size();
 }
 
 JsonObject JsonElement::ToJsonObject() const
 {
-    if (m_type != JsonElement::Type::JSON_OBJECT) {
+    if (m_value.tag.type != JsonElement::Type::JSON_OBJECT) {
         Panic("failed to convert json element %s as an object", TypeName().c_str());
     }
     return *(m_value.objectValue);
@@ -444,24 +734,24 @@ JsonObject JsonElement::ToJsonObject() const
 
 JsonArray JsonElement::ToJsonArray() const
 {
-    if (m_type != JsonElement::Type::JSON_ARRAY) {
+    if (m_value.tag.type != JsonElement::Type::JSON_ARRAY) {
         Panic("failed to convert json element %s as an array", TypeName().c_str());
     }
     return *(m_value.arrayValue);
 }
 
 
-bool JsonElement::IsNull() const { return m_type == JsonElement::Type::JSON_NULL; }
-bool JsonElement::IsBool() const { return m_type == JsonElement::Type::JSON_BOOL; }
-bool JsonElement::IsDouble() const { return m_type == JsonElement::Type::JSON_NUMBER_DOUBLE; }
-bool JsonElement::IsLongInt() const { return m_type == JsonElement::Type::JSON_NUMBER_LONG; }
-bool JsonElement::IsString() const { return m_type == JsonElement::Type::JSON_STRING; }
-bool JsonElement::IsJsonObject() const { return m_type == JsonElement::Type::JSON_OBJECT; }
-bool JsonElement::IsJsonArray() const { return m_type == JsonElement::Type::JSON_ARRAY; }
+bool JsonElement::IsNull() const { return m_value.tag.type == JsonElement::Type::JSON_NULL; }
+bool JsonElement::IsBool() const { return m_value.tag.type == JsonElement::Type::JSON_BOOL; }
+bool JsonElement::IsDouble() const { return m_value.tag.type == JsonElement::Type::JSON_NUMBER_DOUBLE; }
+bool JsonElement::IsLongInt() const { return m_value.tag.type == JsonElement::Type::JSON_NUMBER_LONG; }
+bool JsonElement::IsString() const { return m_value.tag.type == JsonElement::Type::JSON_STRING; }
+bool JsonElement::IsJsonObject() const { return m_value.tag.type == JsonElement::Type::JSON_OBJECT; }
+bool JsonElement::IsJsonArray() const { return m_value.tag.type == JsonElement::Type::JSON_ARRAY; }
 
 std::string JsonElement::TypeName() const
 {
-    switch (m_type) {
+    switch (m_value.tag.type) {
         case JsonElement::Type::JSON_OBJECT:
             return "JSON_OBJECT";
         case JsonElement::Type::JSON_ARRAY:
@@ -483,470 +773,4966 @@ std::string JsonElement::TypeName() const
 
 std::string JsonElement::Serialize() const
 {
-    switch (m_type) {
-        case JsonElement::Type::JSON_NULL: {
-            return "null";
-        }
-        case JsonElement::Type::JSON_BOOL: {
-            return m_value.boolValue ? "true" : "false";
-        }
-        case JsonElement::Type::JSON_NUMBER_DOUBLE: {
-            return DoubleToString(m_value.numberDoubleValue);
-        }
-        case JsonElement::Type::JSON_NUMBER_LONG: {
-            return LongIntToString(m_value.numberLongValue);
-        }
-        case JsonElement::Type::JSON_STRING: {
-            return std::string("\"") + EscapeString(*m_value.stringValue) + "\"";
-        }
-        case JsonElement::Type::JSON_OBJECT: {
-            return JsonObject(*m_value.objectValue).Serialize();
-        }
-        case JsonElement::Type::JSON_ARRAY: {
-            return JsonArray(*m_value.arrayValue).Serialize();
+    JsonWriter writer;
+    writer.Write(*this);
+    return writer.TakeString();
+}
+
+std::string JsonObject::Serialize() const
+{
+    JsonWriter writer;
+    writer.Write(*this);
+    return writer.TakeString();
+}
+
+namespace {
+    // FNV-1a, used by the JsonObject index and the key pool of JsonDocument
+    inline uint32_t HashKey(const char* key, std::size_t length)
+    {
+        uint32_t hash = 2166136261u;
+        for (std::size_t i = 0; i < length; ++i) {
+            hash ^= static_cast<uint8_t>(key[i]);
+            hash *= 16777619u;
         }
+        return hash;
+    }
+
+    inline uint32_t HashKey(const std::string& key)
+    {
+        return HashKey(key.data(), key.size());
     }
-    Panic("unknown type to serialize: %s", TypeName().c_str());
-    return "";
 }
 
-std::string JsonObject::Serialize() const
+JsonElement& JsonObject::operator [] (const std::string& key)
 {
-    std::string res = "{";
-    bool moreThanOneItem = false;
-    for (const auto& kv: *this) {
-        moreThanOneItem = true;
-        res += std::string("\"") + EscapeString(kv.first) + "\":" + kv.second.Serialize() + ",";
+    std::size_t pos = FindPosition(key);
+    if (pos != m_members.size()) {
+        return m_members[pos].second;
     }
-    if (moreThanOneItem) {
-        res.pop_back();
+    return Append(std::string(key));
+}
+
+JsonElement& JsonObject::operator [] (std::string&& key)
+{
+    std::size_t pos = FindPosition(key);
+    if (pos != m_members.size()) {
+        return m_members[pos].second;
     }
-    res += "}";
-    return res;
+    return Append(std::move(key));
 }
 
-std::string JsonArray::Serialize() const
+JsonElement& JsonObject::at(const std::string& key)
 {
-    std::string res = "[";
-    bool moreThanOne = false;
-    for (const auto& v: *this) {
-        moreThanOne = true;
-        res += v.Serialize() + ",";
+    std::size_t pos = FindPosition(key);
+    if (pos == m_members.size()) {
+        throw std::out_of_range("json object has no member " + key);
     }
-    if (moreThanOne) {
-        res.pop_back();
+    return m_members[pos].second;
+}
+
+const JsonElement& JsonObject::at(const std::string& key) const
+{
+    std::size_t pos = FindPosition(key);
+    if (pos == m_members.size()) {
+        throw std::out_of_range("json object has no member " + key);
     }
-    res += "]";
-    return res;
+    return m_members[pos].second;
 }
 
+JsonObject::iterator JsonObject::find(const std::string& key)
+{
+    return m_members.begin() + FindPosition(key);
+}
 
-JsonScanner::JsonScanner(const std::string &str): m_str(str), m_pos(0), m_prevPos(0)
-{}
+JsonObject::const_iterator JsonObject::find(const std::string& key) const
+{
+    return m_members.begin() + FindPosition(key);
+}
 
-void JsonScanner::Reset() { m_pos = 0; m_prevPos = 0; }
+JsonObject::size_type JsonObject::count(const std::string& key) const
+{
+    return FindPosition(key) == m_members.size() ? 0 : 1;
+}
 
-// return a non space token
-JsonScanner::Token JsonScanner::Next()
+std::pair<JsonObject::iterator, bool> JsonObject::insert(const value_type& member)
 {
-    m_prevPos = m_pos;
-    if (m_str.length() <= m_pos || !SkipWhitespaceToken()) {
-        return Token::EOF_TOKEN;
-    }
+    return insert(value_type(member));
+}
 
-    char curChar = m_str[m_pos];
-    if (IsDigit(curChar) || curChar == '-') {
-        ScanNextNumber();
-        return Token::NUMBER;
-    }
-    switch (curChar) {
-        case '\"':
-            ScanNextString();
-            return Token::STRING;
-        case 't':
-            ScanLiteral("true", 4);
-            return Token::LITERAL_TRUE;
-        case 'f':
-            ScanLiteral("false", 5);
-            return Token::LITERAL_FALSE;
-        case 'n':
-            ScanLiteral("null", 4);
-            return Token::LITERAL_NULL;
-        case '[':
-            m_pos ++;
-            return Token::ARRAY_BEGIN;
-        case ']':
-            m_pos ++;
-            return Token::ARRAY_END;
-        case '{':
-            m_pos ++;
-            return Token::OBJECT_BEGIN;
-        case '}':
-            m_pos ++;
-            return Token::OBJECT_END;
-        case ',':
-            m_pos ++;
-            return Token::COMMA;
-        case ':':
-            m_pos ++;
-            return Token::COLON;
+std::pair<JsonObject::iterator, bool> JsonObject::insert(value_type&& member)
+{
+    std::size_t pos = FindPosition(member.first);
+    if (pos != m_members.size()) {
+        return std::make_pair(m_members.begin() + pos, false);
     }
-    Panic("Invalid token at position %lu", m_pos);
-    return Token::LITERAL_NULL;
+    Append(std::move(member.first)) = std::move(member.second);
+    return std::make_pair(m_members.end() - 1, true);
 }
 
+JsonObject::iterator JsonObject::erase(const_iterator pos)
+{
+    std::size_t offset = static_cast<std::size_t>(pos - m_members.cbegin());
+    m_members.erase(m_members.begin() + offset);
+    // positions after the erased member have shifted
+    RebuildIndex();
+    return m_members.begin() + offset;
+}
 
-void JsonScanner::ScanNextString()
+JsonObject::size_type JsonObject::erase(const std::string& key)
 {
-    size_t beginPos = m_pos;
-    m_pos ++; // skip left "
-    while (m_pos < m_str.size() && m_str[m_pos] != '\"') {
-        char curChar = m_str[m_pos ++];
-        if (curChar == '\\') {
-            // " quotation mark
-            // \ reverse soildus
-            // / sodilus
-            // b backspace
-            // f formfeed
-            // n linefeed
-            // r carriage return
-            // t horizontal tab
-            // u (4 hex digits)
-            if (m_pos >= m_str.size()) {
-                Panic("missing token, position: %lu", m_pos);
-                return;
-            } else {
-                char escapeChar = m_str[m_pos];
-                if (escapeChar == '\"' || escapeChar == 'r' || escapeChar == 'f' || escapeChar == 'n' ||
-                    escapeChar == 't' || escapeChar == 'b' || escapeChar == '\\' || escapeChar == '/') {
-                    // TODO:: / sodilus
-                    m_pos ++;
-                } else if (escapeChar == 'u') {
-                    m_pos += 4;
-                }
-            }
-        }
-    }
-    if (m_pos >= m_str.size()) {
-        Panic("missing end of string, position: %lu", beginPos);
+    std::size_t pos = FindPosition(key);
+    if (pos == m_members.size()) {
+        return 0;
     }
-    m_pos ++; // skip right "
-    std::string rawStr = m_str.substr(beginPos + 1, m_pos - beginPos - 2);
-    m_tmpStrValue = util::UnescapeString(rawStr);
+    erase(m_members.cbegin() + pos);
+    return 1;
 }
 
-void JsonScanner::ScanNextNumber()
+void JsonObject::clear()
 {
-    size_t beginPos = m_pos;
-    // example: "-114.51E-4"
-    m_pos ++; // skip + or - or first digit
-    while (m_pos < m_str.size() && IsDigit(m_str[m_pos])) {
-        m_pos ++;
-    }
-    if (m_pos + 1 < m_str.size() && m_str[m_pos] == '.' && IsDigit(m_str[m_pos + 1])) {
-        m_pos ++; // skip .
-        while(m_pos < m_str.size() && IsDigit(m_str[m_pos])) {
-            m_pos ++;
+    m_members.clear();
+    m_index.clear();
+}
+
+void JsonObject::reserve(size_type count)
+{
+    m_members.reserve(count);
+}
+
+/*
+ * return the position of the member, or size() if it is absent
+ */
+std::size_t JsonObject::FindPosition(const std::string& key) const
+{
+    if (m_index.empty()) {
+        for (std::size_t pos = 0; pos < m_members.size(); ++pos) {
+            if (m_members[pos].first == key) {
+                return pos;
+            }
         }
+        return m_members.size();
     }
-    if (m_pos + 1 < m_str.size() && (m_str[m_pos] == 'E' || m_str[m_pos] == 'e')) {
-        m_pos ++;
-        if (m_str[m_pos] == '-' || m_str[m_pos] == '+') {
-            m_pos ++;
+    std::size_t mask = m_index.size() - 1;
+    for (std::size_t slot = HashKey(key) & mask; m_index[slot] != 0; slot = (slot + 1) & mask) {
+        std::size_t pos = m_index[slot] - 1;
+        if (m_members[pos].first == key) {
+            return pos;
+        }
+    }
+    return m_members.size();
+}
+
+JsonElement& JsonObject::Append(std::string&& key)
+{
+    if (m_members.size() >= std::numeric_limits<uint32_t>::max()) {
+        Panic("json object exceeds %u members", std::numeric_limits<uint32_t>::max());
+    }
+    m_members.emplace_back(std::move(key), JsonElement());
+    if (!m_index.empty() && m_members.size() * 2 <= m_index.size()) {
+        IndexMember(m_members.size() - 1);
+    } else if (m_members.size() > INDEX_THRESHOLD) {
+        RebuildIndex();
+    }
+    return m_members.back().second;
+}
+
+void JsonObject::IndexMember(std::size_t pos)
+{
+    std::size_t mask = m_index.size() - 1;
+    std::size_t slot = HashKey(m_members[pos].first) & mask;
+    while (m_index[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+    m_index[slot] = static_cast<uint32_t>(pos + 1);
+}
+
+/*
+ * size the index to at least twice the member count so that probe chains stay short
+ */
+void JsonObject::RebuildIndex()
+{
+    m_index.clear();
+    if (m_members.size() <= INDEX_THRESHOLD) {
+        m_index.shrink_to_fit();
+        return;
+    }
+    std::size_t capacity = 16;
+    while (capacity < m_members.size() * 4) {
+        capacity *= 2;
+    }
+    m_index.assign(capacity, 0);
+    for (std::size_t pos = 0; pos < m_members.size(); ++pos) {
+        IndexMember(pos);
+    }
+}
+
+std::string JsonArray::Serialize() const
+{
+    JsonWriter writer;
+    writer.Write(*this);
+    return writer.TakeString();
+}
+
+namespace {
+    // buffered text is handed to the sink once it grows past this size
+    const std::size_t WRITER_FLUSH_THRESHOLD = 64 * 1024;
+}
+
+JsonWriter::JsonWriter()
+{}
+
+JsonWriter::JsonWriter(std::ostream& sink) : m_sink(&sink)
+{
+    m_buffer.reserve(WRITER_FLUSH_THRESHOLD);
+}
+
+JsonWriter::~JsonWriter()
+{
+    if (m_sink != nullptr) {
+        Flush();
+    }
+}
+
+void JsonWriter::BeginValue()
+{
+    if (m_needComma) {
+        m_buffer.push_back(',');
+    }
+}
+
+void JsonWriter::EndValue()
+{
+    m_needComma = true;
+    if (m_sink != nullptr && m_buffer.size() >= WRITER_FLUSH_THRESHOLD) {
+        Flush();
+    }
+}
+
+void JsonWriter::StartObject()
+{
+    BeginValue();
+    m_buffer.push_back('{');
+    m_needComma = false;
+}
+
+void JsonWriter::EndObject()
+{
+    m_buffer.push_back('}');
+    EndValue();
+}
+
+void JsonWriter::StartArray()
+{
+    BeginValue();
+    m_buffer.push_back('[');
+    m_needComma = false;
+}
+
+void JsonWriter::EndArray()
+{
+    m_buffer.push_back(']');
+    EndValue();
+}
+
+void JsonWriter::Key(const std::string& key)
+{
+    Key(key.c_str(), key.length());
+}
+
+void JsonWriter::Key(const char* key, std::size_t length)
+{
+    BeginValue();
+    m_buffer.push_back('"');
+    AppendEscapedString(m_buffer, key, length);
+    m_buffer.append("\":", 2);
+    m_needComma = false;
+}
+
+void JsonWriter::String(const std::string& str)
+{
+    String(str.c_str(), str.length());
+}
+
+void JsonWriter::String(const char* str, std::size_t length)
+{
+    BeginValue();
+    m_buffer.push_back('"');
+    AppendEscapedString(m_buffer, str, length);
+    m_buffer.push_back('"');
+    EndValue();
+}
+
+void JsonWriter::Int64(int64_t value)
+{
+    BeginValue();
+    std::size_t size = m_buffer.size();
+    m_buffer.resize(size + MAX_NUMBER_LENGTH);
+    m_buffer.resize(size + FormatLongInt(value, &m_buffer[size]));
+    EndValue();
+}
+
+void JsonWriter::Double(double value)
+{
+    BeginValue();
+    std::size_t size = m_buffer.size();
+    m_buffer.resize(size + MAX_NUMBER_LENGTH);
+    m_buffer.resize(size + FormatDouble(value, &m_buffer[size]));
+    EndValue();
+}
+
+void JsonWriter::Bool(bool value)
+{
+    BeginValue();
+    if (value) {
+        m_buffer.append("true", 4);
+    } else {
+        m_buffer.append("false", 5);
+    }
+    EndValue();
+}
+
+void JsonWriter::Null()
+{
+    BeginValue();
+    m_buffer.append("null", 4);
+    EndValue();
+}
+
+void JsonWriter::Write(const JsonElement& element)
+{
+    switch (element.m_value.tag.type) {
+        case JsonElement::Type::JSON_NULL: {
+            Null();
+            return;
+        }
+        case JsonElement::Type::JSON_BOOL: {
+            Bool(element.m_value.boolValue);
+            return;
+        }
+        case JsonElement::Type::JSON_NUMBER_DOUBLE: {
+            Double(element.m_value.numberDoubleValue);
+            return;
+        }
+        case JsonElement::Type::JSON_NUMBER_LONG: {
+            Int64(element.m_value.numberLongValue);
+            return;
+        }
+        case JsonElement::Type::JSON_STRING: {
+            String(element.StringData(), element.StringLength());
+            return;
+        }
+        case JsonElement::Type::JSON_OBJECT: {
+            Write(*element.m_value.objectValue);
+            return;
+        }
+        case JsonElement::Type::JSON_ARRAY: {
+            Write(*element.m_value.arrayValue);
+            return;
         }
-        // parse number
-        while (m_pos < m_str.size() && IsDigit(m_str[m_pos])) {
+    }
+    Panic("unknown type to serialize: %s", element.TypeName().c_str());
+}
+
+void JsonWriter::Write(const JsonObject& object)
+{
+    StartObject();
+    for (const auto& kv: object) {
+        Key(kv.first);
+        Write(kv.second);
+    }
+    EndObject();
+}
+
+void JsonWriter::Write(const JsonArray& array)
+{
+    StartArray();
+    for (const JsonElement& element: array) {
+        Write(element);
+    }
+    EndArray();
+}
+
+const std::string& JsonWriter::GetString() const
+{
+    return m_buffer;
+}
+
+std::string JsonWriter::TakeString()
+{
+    std::string res = std::move(m_buffer);
+    Clear();
+    return res;
+}
+
+void JsonWriter::Flush()
+{
+    if (m_sink != nullptr && !m_buffer.empty()) {
+        m_sink->write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+        m_buffer.clear();
+    }
+}
+
+void JsonWriter::Clear()
+{
+    m_buffer.clear();
+    m_needComma = false;
+}
+
+
+JsonScanner::JsonScanner(const char* data, std::size_t length)
+    : m_data(data), m_length(length), m_pos(0), m_prevPos(0)
+{}
+
+void JsonScanner::Reset() { m_pos = 0; m_prevPos = 0; m_structuralCursor = 0; }
+
+void JsonScanner::UseStructuralIndex(bool enable)
+{
+    // positions are stored as 32-bit offsets
+    if (!enable || m_length > UINT32_MAX) {
+        m_useStructuralIndex = false;
+        return;
+    }
+    if (!m_useStructuralIndex) {
+        util::BuildStructuralIndex(m_data, m_length, m_structurals);
+        m_structuralCursor = 0;
+        m_useStructuralIndex = true;
+    }
+}
+
+// m_pos is a whitespace outside of any string, the next non whitespace char is always an indexed position
+bool JsonScanner::SkipToNextStructural()
+{
+    while (m_structuralCursor < m_structurals.size() && m_structurals[m_structuralCursor] < m_pos) {
+        m_structuralCursor++;
+    }
+    m_pos = m_structuralCursor < m_structurals.size() ? m_structurals[m_structuralCursor] : m_length;
+    return m_pos < m_length;
+}
+
+// return a non space token
+JsonScanner::Token JsonScanner::Next()
+{
+    m_prevPos = m_pos;
+    if (m_length <= m_pos || !SkipWhitespaceToken()) {
+        return Token::EOF_TOKEN;
+    }
+
+    char curChar = m_data[m_pos];
+    if (IsDigit(curChar) || curChar == '-') {
+        ScanNextNumber();
+        return Token::NUMBER;
+    }
+    switch (curChar) {
+        case '\"':
+            ScanNextString();
+            return Token::STRING;
+        case 't':
+            ScanLiteral("true", 4);
+            return Token::LITERAL_TRUE;
+        case 'f':
+            ScanLiteral("false", 5);
+            return Token::LITERAL_FALSE;
+        case 'n':
+            ScanLiteral("null", 4);
+            return Token::LITERAL_NULL;
+        case '[':
+            m_pos ++;
+            return Token::ARRAY_BEGIN;
+        case ']':
+            m_pos ++;
+            return Token::ARRAY_END;
+        case '{':
+            m_pos ++;
+            return Token::OBJECT_BEGIN;
+        case '}':
+            m_pos ++;
+            return Token::OBJECT_END;
+        case ',':
             m_pos ++;
+            return Token::COMMA;
+        case ':':
+            m_pos ++;
+            return Token::COLON;
+    }
+    Panic("Invalid token at position %lu", m_pos);
+    return Token::LITERAL_NULL;
+}
+
+
+// decode the string in a single pass: plain runs are located with SIMD and appended in bulk, escapes are decoded inline
+void JsonScanner::ScanNextString()
+{
+    size_t beginPos = m_pos;
+    m_pos ++; // skip left "
+    m_tmpStrValue.clear();
+    while (true) {
+        size_t runEnd = util::FindQuoteOrBackslash(m_data, m_pos, m_length);
+        m_tmpStrValue.append(m_data + m_pos, runEnd - m_pos);
+        m_pos = runEnd;
+        if (m_pos >= m_length) {
+            Panic("missing end of string, position: %lu", beginPos);
+        }
+        if (m_data[m_pos] == '\"') {
+            m_pos ++; // skip right "
+            return;
+        }
+        m_pos ++; // skip backslash
+        if (m_pos >= m_length) {
+            Panic("missing token, position: %lu", m_pos);
+        }
+        char escapeChar = m_data[m_pos ++];
+        switch (escapeChar) {
+            case '\"': m_tmpStrValue.push_back('\"'); break;
+            case '\\': m_tmpStrValue.push_back('\\'); break;
+            case '/': m_tmpStrValue.push_back('/'); break;
+            case 'b': m_tmpStrValue.push_back('\b'); break;
+            case 'f': m_tmpStrValue.push_back('\f'); break;
+            case 'n': m_tmpStrValue.push_back('\n'); break;
+            case 'r': m_tmpStrValue.push_back('\r'); break;
+            case 't': m_tmpStrValue.push_back('\t'); break;
+            case 'u': {
+                uint32_t codePoint = ScanHex4();
+                if (codePoint >= 0xD800 && codePoint <= 0xDBFF) {
+                    // high surrogate, must be followed by an escaped low surrogate
+                    if (m_pos + 1 >= m_length || m_data[m_pos] != '\\' || m_data[m_pos + 1] != 'u') {
+                        Panic("missing low surrogate, position: %lu", m_pos);
+                    }
+                    m_pos += 2;
+                    uint32_t lowSurrogate = ScanHex4();
+                    if (lowSurrogate < 0xDC00 || lowSurrogate > 0xDFFF) {
+                        Panic("invalid low surrogate, position: %lu", m_pos);
+                    }
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (lowSurrogate - 0xDC00);
+                } else if (codePoint >= 0xDC00 && codePoint <= 0xDFFF) {
+                    Panic("unexpected low surrogate, position: %lu", m_pos);
+                }
+                util::AppendUtf8(m_tmpStrValue, codePoint);
+                break;
+            }
+            default: Panic("invalid escaped char \\%c, position: %lu", escapeChar, m_pos - 1);
+        }
+    }
+}
+
+uint32_t JsonScanner::ScanHex4()
+{
+    uint32_t value = 0;
+    for (size_t i = 0; i < 4; ++i, ++m_pos) {
+        char ch = m_pos < m_length ? m_data[m_pos] : '\0';
+        value <<= 4;
+        if ('0' <= ch && ch <= '9') {
+            value |= static_cast<uint32_t>(ch - '0');
+        } else if ('a' <= ch && ch <= 'f') {
+            value |= static_cast<uint32_t>(ch - 'a' + 10);
+        } else if ('A' <= ch && ch <= 'F') {
+            value |= static_cast<uint32_t>(ch - 'A' + 10);
+        } else {
+            // the 4 hex digits can never hide a quote, this keeps the structural index in sync
+            Panic("invalid unicode escape, position: %lu", m_pos);
+        }
+    }
+    return value;
+}
+
+void JsonScanner::ScanNextNumber()
+{
+    size_t beginPos = m_pos;
+    if (!util::ScanNumber(m_data, m_length, m_pos, m_int64Number, m_tmpNumberLongValue, m_tmpNumberDoubleValue)) {
+        Panic("invalid number at position %lu", beginPos);
+    }
+}
+
+double JsonScanner::GetDoubleValue() const { return m_tmpNumberDoubleValue; }
+
+int64_t JsonScanner::GetLongIntValue() const { return m_tmpNumberLongValue; }
+
+bool JsonScanner::IsNumberLongInt() const { return m_int64Number; }
+
+const std::string& JsonScanner::GetStringValue() const { return m_tmpStrValue; }
+
+std::string JsonScanner::TokenName(Token token)
+{
+    switch (token) {
+        case Token::WHITESPACE:     return "WHITESPACE";
+        case Token::NUMBER:         return "NUMBER";
+        case Token::STRING:         return "STRING";
+        case Token::LITERAL_TRUE:   return "LITERAL_TRUE";
+        case Token::LITERAL_FALSE:  return "LITERAL_FALSE";
+        case Token::LITERAL_NULL:   return "LITERAL_NULL";
+        case Token::COMMA:          return "COMMA";
+        case Token::COLON:          return "COLON";
+        case Token::ARRAY_BEGIN:    return "ARRAY_BEGIN";
+        case Token::ARRAY_END:      return "ARRAY_END";
+        case Token::OBJECT_BEGIN:   return "OBJECT_BEGIN";
+        case Token::OBJECT_END:     return "OBJECT_END";
+        case Token::EOF_TOKEN:      return "EOF_TOKEN";
+    }
+    Panic("Unexpected token");
+    return "";
+}
+
+
+
+namespace {
+    // members of the objects being parsed that fit before the shared member stack first grows
+    const std::size_t MEMBER_STACK_RESERVE = 16;
+}
+
+JsonParser::JsonParser(const std::string& str)
+{
+    m_scanner = new JsonScanner(str.data(), str.size());
+    m_members.reserve(MEMBER_STACK_RESERVE);
+}
+
+JsonParser::JsonParser(std::string&& str): m_buffer(std::move(str))
+{
+    m_scanner = new JsonScanner(m_buffer.data(), m_buffer.size());
+    m_members.reserve(MEMBER_STACK_RESERVE);
+}
+
+JsonParser::JsonParser(const char* data, std::size_t length)
+{
+    m_scanner = new JsonScanner(data, length);
+    m_members.reserve(MEMBER_STACK_RESERVE);
+}
+
+JsonParser::~JsonParser()
+{
+    if (m_scanner != nullptr) {
+        delete m_scanner;
+        m_scanner = nullptr;
+    }
+}
+
+JsonElement JsonParser::ParseFile(const std::string& path)
+{
+    FileBuffer file(path);
+    JsonParser parser(file.Data(), file.Size());
+    return parser.Parse();
+}
+
+void JsonParser::UseStructuralIndex(bool enable)
+{
+    m_scanner->UseStructuralIndex(enable);
+}
+
+JsonElement JsonParser::Parse()
+{
+    m_scanner->Reset();
+    m_depth = 0;
+    m_members.clear();
+    JsonElement ele = ParseNext();
+    if (m_scanner->Next() != JsonScanner::Token::EOF_TOKEN) {
+        Panic("json scanner reached non-eof token, position = %lu", m_scanner->Position());
+    }
+    return ele;
+}
+
+bool JsonParser::IsValid()
+{
+    JsonError error;
+    return Validate(error);
+}
+
+bool JsonParser::Validate(JsonError& error)
+{
+    JsonValidator validator(m_scanner->Data(), m_scanner->Length());
+    return validator.Validate(error);
+}
+
+bool JsonParser::TryParse(JsonElement& element, JsonError& error)
+{
+    // the validator rejects exactly the input Parse() panics on, including nesting beyond MAX_DEPTH,
+    // so only std::bad_alloc can still escape from here
+    if (!Validate(error)) {
+        return false;
+    }
+    element = Parse();
+    return true;
+}
+
+void JsonError::Locate(const char* data, std::size_t& line, std::size_t& column) const
+{
+    line = 1;
+    std::size_t lineBegin = 0;
+    for (std::size_t i = 0; i < offset; ++i) {
+        if (data[i] == '\n') {
+            line++;
+            lineBegin = i + 1;
+        }
+    }
+    column = offset - lineBegin + 1;
+}
+
+const char* JsonError::Reason() const
+{
+    switch (code) {
+        case JsonErrorCode::NONE: return "no error";
+        case JsonErrorCode::UNEXPECTED_END: return "unexpected end of input";
+        case JsonErrorCode::INVALID_TOKEN: return "invalid token";
+        case JsonErrorCode::INVALID_LITERAL: return "invalid literal";
+        case JsonErrorCode::INVALID_NUMBER: return "invalid number";
+        case JsonErrorCode::INVALID_ESCAPE: return "invalid escape in string";
+        case JsonErrorCode::MISSING_QUOTE: return "missing end of string";
+        case JsonErrorCode::EXPECT_KEY: return "expect a string as key for json object";
+        case JsonErrorCode::EXPECT_COLON: return "expect ':' in json object";
+        case JsonErrorCode::EXPECT_COMMA_OR_END: return "expect ',' or the end of the container";
+        case JsonErrorCode::EXPECT_VALUE: return "expect a value";
+        case JsonErrorCode::TRAILING_CONTENT: return "unexpected content after the json value";
+        case JsonErrorCode::DEPTH_EXCEEDED: return "containers nested too deep";
+    }
+    return "unknown error";
+}
+
+JsonValidator::JsonValidator(const char* data, std::size_t length) : m_data(data), m_length(length)
+{}
+
+bool JsonValidator::Validate(JsonError& error)
+{
+    m_error = &error;
+    error = JsonError();
+    m_pos = 0;
+    m_depth = 0;
+    bool inObject = false;
+    while (true) {
+        // a value is expected at m_pos
+        SkipWhitespace();
+        if (m_pos >= m_length) {
+            return Fail(m_depth == 0 ? JsonErrorCode::EXPECT_VALUE : JsonErrorCode::UNEXPECTED_END, m_pos);
+        }
+        char ch = m_data[m_pos];
+        bool closed = true; // whether the value ended here, false when a container was opened
+        if (ch == '{' || ch == '[') {
+            if (m_depth >= JsonParser::MAX_DEPTH) {
+                return Fail(JsonErrorCode::DEPTH_EXCEEDED, m_pos);
+            }
+            m_pos++;
+            SkipWhitespace();
+            if (m_pos < m_length && m_data[m_pos] == (ch == '{' ? '}' : ']')) {
+                m_pos++;
+            } else {
+                Push(ch == '{');
+                inObject = (ch == '{');
+                closed = false;
+            }
+        } else if (ch == '\"') {
+            if (!SkipString()) {
+                return false;
+            }
+        } else if (('0' <= ch && ch <= '9') || ch == '-') {
+            if (!SkipNumber()) {
+                return false;
+            }
+        } else if (ch == 't') {
+            if (!SkipLiteral("true", 4)) {
+                return false;
+            }
+        } else if (ch == 'f') {
+            if (!SkipLiteral("false", 5)) {
+                return false;
+            }
+        } else if (ch == 'n') {
+            if (!SkipLiteral("null", 4)) {
+                return false;
+            }
+        } else if (ch == ']' || ch == '}' || ch == ',' || ch == ':') {
+            return Fail(JsonErrorCode::EXPECT_VALUE, m_pos);
+        } else {
+            return Fail(JsonErrorCode::INVALID_TOKEN, m_pos);
+        }
+
+        // close every container that ends after this value
+        while (closed) {
+            if (m_depth == 0) {
+                SkipWhitespace();
+                return m_pos >= m_length ? true : Fail(JsonErrorCode::TRAILING_CONTENT, m_pos);
+            }
+            SkipWhitespace();
+            if (m_pos >= m_length) {
+                return Fail(JsonErrorCode::UNEXPECTED_END, m_pos);
+            }
+            if (m_data[m_pos] == ',') {
+                m_pos++;
+                break;
+            }
+            if (m_data[m_pos] != (inObject ? '}' : ']')) {
+                return Fail(JsonErrorCode::EXPECT_COMMA_OR_END, m_pos);
+            }
+            m_pos++;
+            inObject = Pop();
+        }
+
+        if (inObject) {
+            // member key and colon before the next value
+            SkipWhitespace();
+            if (m_pos >= m_length) {
+                return Fail(JsonErrorCode::UNEXPECTED_END, m_pos);
+            }
+            if (m_data[m_pos] != '\"') {
+                return Fail(JsonErrorCode::EXPECT_KEY, m_pos);
+            }
+            if (!SkipString()) {
+                return false;
+            }
+            SkipWhitespace();
+            if (m_pos >= m_length) {
+                return Fail(JsonErrorCode::UNEXPECTED_END, m_pos);
+            }
+            if (m_data[m_pos] != ':') {
+                return Fail(JsonErrorCode::EXPECT_COLON, m_pos);
+            }
+            m_pos++;
+        }
+    }
+}
+
+bool JsonValidator::Fail(JsonErrorCode code, std::size_t offset)
+{
+    m_error->code = code;
+    m_error->offset = offset;
+    return false;
+}
+
+bool JsonValidator::SkipString()
+{
+    std::size_t beginPos = m_pos;
+    m_pos++; // skip left "
+    while (true) {
+        m_pos = util::FindQuoteOrBackslash(m_data, m_pos, m_length);
+        if (m_pos >= m_length) {
+            return Fail(JsonErrorCode::MISSING_QUOTE, beginPos);
+        }
+        if (m_data[m_pos] == '\"') {
+            m_pos++;
+            return true;
+        }
+        std::size_t escapePos = m_pos;
+        m_pos++; // skip backslash
+        if (m_pos >= m_length) {
+            return Fail(JsonErrorCode::MISSING_QUOTE, beginPos);
+        }
+        char escapeChar = m_data[m_pos++];
+        switch (escapeChar) {
+            case '\"':
+            case '\\':
+            case '/':
+            case 'b':
+            case 'f':
+            case 'n':
+            case 'r':
+            case 't':
+                break;
+            case 'u': {
+                uint32_t codePoint = 0;
+                if (!ScanHex4(codePoint)) {
+                    return Fail(JsonErrorCode::INVALID_ESCAPE, escapePos);
+                }
+                if (codePoint >= 0xD800 && codePoint <= 0xDBFF) {
+                    uint32_t lowSurrogate = 0;
+                    if (m_pos + 1 >= m_length || m_data[m_pos] != '\\' || m_data[m_pos + 1] != 'u') {
+                        return Fail(JsonErrorCode::INVALID_ESCAPE, escapePos);
+                    }
+                    m_pos += 2;
+                    if (!ScanHex4(lowSurrogate) || lowSurrogate < 0xDC00 || lowSurrogate > 0xDFFF) {
+                        return Fail(JsonErrorCode::INVALID_ESCAPE, escapePos);
+                    }
+                } else if (codePoint >= 0xDC00 && codePoint <= 0xDFFF) {
+                    return Fail(JsonErrorCode::INVALID_ESCAPE, escapePos);
+                }
+                break;
+            }
+            default: return Fail(JsonErrorCode::INVALID_ESCAPE, escapePos);
+        }
+    }
+}
+
+bool JsonValidator::ScanHex4(uint32_t& value)
+{
+    value = 0;
+    for (std::size_t i = 0; i < 4; ++i, ++m_pos) {
+        char ch = m_pos < m_length ? m_data[m_pos] : '\0';
+        value <<= 4;
+        if ('0' <= ch && ch <= '9') {
+            value |= static_cast<uint32_t>(ch - '0');
+        } else if ('a' <= ch && ch <= 'f') {
+            value |= static_cast<uint32_t>(ch - 'a' + 10);
+        } else if ('A' <= ch && ch <= 'F') {
+            value |= static_cast<uint32_t>(ch - 'A' + 10);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// same grammar as util::ScanNumber without computing the value
+bool JsonValidator::SkipNumber()
+{
+    std::size_t beginPos = m_pos;
+    if (m_data[m_pos] == '-') {
+        m_pos++;
+    }
+    if (m_pos >= m_length || !IsDigit(m_data[m_pos])) {
+        return Fail(JsonErrorCode::INVALID_NUMBER, beginPos);
+    }
+    while (m_pos < m_length && IsDigit(m_data[m_pos])) {
+        m_pos++;
+    }
+    if (m_pos + 1 < m_length && m_data[m_pos] == '.' && IsDigit(m_data[m_pos + 1])) {
+        for (m_pos++; m_pos < m_length && IsDigit(m_data[m_pos]); m_pos++) {}
+    }
+    if (m_pos < m_length && (m_data[m_pos] == 'e' || m_data[m_pos] == 'E')) {
+        m_pos++;
+        if (m_pos < m_length && (m_data[m_pos] == '-' || m_data[m_pos] == '+')) {
+            m_pos++;
+        }
+        if (m_pos >= m_length || !IsDigit(m_data[m_pos])) {
+            return Fail(JsonErrorCode::INVALID_NUMBER, beginPos);
+        }
+        while (m_pos < m_length && IsDigit(m_data[m_pos])) {
+            m_pos++;
+        }
+    }
+    return true;
+}
+
+bool JsonValidator::SkipLiteral(const char* literal, std::size_t length)
+{
+    if (m_pos + length > m_length || std::memcmp(m_data + m_pos, literal, length) != 0) {
+        return Fail(JsonErrorCode::INVALID_LITERAL, m_pos);
+    }
+    m_pos += length;
+    return true;
+}
+
+// the caller checks m_depth against JsonParser::MAX_DEPTH first
+void JsonValidator::Push(bool isObject)
+{
+    uint64_t bit = static_cast<uint64_t>(1) << (m_depth % 64);
+    if (isObject) {
+        m_stack[m_depth / 64] |= bit;
+    } else {
+        m_stack[m_depth / 64] &= ~bit;
+    }
+    m_depth++;
+}
+
+bool JsonValidator::Pop()
+{
+    m_depth--;
+    if (m_depth == 0) {
+        return false;
+    }
+    std::size_t top = m_depth - 1;
+    return (m_stack[top / 64] >> (top % 64)) & 1;
+}
+
+JsonElement JsonParser::ParseNext()
+{
+    JsonScanner::Token token = m_scanner->Next();
+    switch (token) {
+        case JsonScanner::Token::OBJECT_BEGIN: {
+            EnterContainer();
+            JsonElement element(ParseJsonObject());
+            m_depth--;
+            return element;
+        }
+        case JsonScanner::Token::ARRAY_BEGIN: {
+            EnterContainer();
+            JsonElement element(ParseJsonArray());
+            m_depth--;
+            return element;
+        }
+        case JsonScanner::Token::STRING: {
+            return JsonElement(m_scanner->GetStringValue());
+        }
+        case JsonScanner::Token::NUMBER: {
+            return m_scanner->IsNumberLongInt() ? 
+                JsonElement(m_scanner->GetLongIntValue()) : JsonElement(m_scanner->GetDoubleValue());
+        }
+        case JsonScanner::Token::LITERAL_TRUE: {
+            return JsonElement(true);
+        }
+        case JsonScanner::Token::LITERAL_FALSE: {
+            return JsonElement(false);
+        }
+        case JsonScanner::Token::LITERAL_NULL: {
+            return JsonElement();
+        }
+        case JsonScanner::Token::WHITESPACE:
+        case JsonScanner::Token::COMMA:
+        case JsonScanner::Token::COLON:
+        case JsonScanner::Token::ARRAY_END:
+        case JsonScanner::Token::OBJECT_END:
+        case JsonScanner::Token::EOF_TOKEN:
+        default : Panic("scanner return unexpected token: %s", JsonScanner::TokenName(token).c_str());
+    }
+    return JsonElement();
+}
+
+// called on an opening bracket, the recursive descent would otherwise overflow the stack on hostile input
+void JsonParser::EnterContainer()
+{
+    if (m_depth >= MAX_DEPTH) {
+        Panic("json nesting exceeds %lu levels, position: %lu", MAX_DEPTH, m_scanner->Position());
+    }
+    m_depth++;
+}
+
+JsonObject JsonParser::ParseJsonObject()
+{
+    JsonObject object {};
+    JsonScanner::Token token = m_scanner->Next();
+    if (token == JsonScanner::Token::OBJECT_END) {
+        return object;
+    }
+    m_scanner->RollBack();
+
+    // nested objects push above base and pop back to it before returning
+    std::size_t base = m_members.size();
+    while (true) {
+        size_t pos = m_scanner->Position();
+        token = m_scanner->Next();
+        if (token != JsonScanner::Token::STRING) {
+            Panic("expect a string as key for json object, position: %lu", pos);
+        }
+        std::string key = m_scanner->GetStringValue();
+
+        pos = m_scanner->Position();
+        token = m_scanner->Next();
+        if (token != JsonScanner::Token::COLON) {
+            Panic("expect ':' in json object, position: %lu", pos);
+        }
+        JsonElement value = ParseNext();
+        m_members.emplace_back(std::move(key), std::move(value));
+
+        pos = m_scanner->Position();
+        token = m_scanner->Next();
+        if (token == JsonScanner::Token::OBJECT_END) {
+            break;
+        }
+        if (token != JsonScanner::Token::COMMA) {
+            Panic("expect ',' in json object, position: %lu", pos);
+        }
+    }
+    object.reserve(m_members.size() - base);
+    for (std::size_t i = base; i < m_members.size(); ++i) {
+        // a repeated key keeps the last value
+        object[std::move(m_members[i].first)] = std::move(m_members[i].second);
+    }
+    m_members.erase(m_members.begin() + base, m_members.end());
+    return object;
+}
+
+JsonArray JsonParser::ParseJsonArray()
+{
+    JsonArray array {};
+    JsonScanner::Token token = m_scanner->Next();
+    if (token == JsonScanner::Token::ARRAY_END) {
+        return array;
+    }
+    m_scanner->RollBack();
+
+    while (true) {
+        array.push_back(ParseNext());
+        size_t pos = m_scanner->Position();
+        token = m_scanner->Next();
+        if (token == JsonScanner::Token::ARRAY_END) {
+            break;
+        }
+        if (token != JsonScanner::Token::COMMA) {
+            Panic("expect ',' in array, pos: %lu", pos);
+        }
+    }
+    return array;
+}
+
+JsonElement JsonParser::ParseParallel(std::size_t threadCount)
+{
+    // smaller slices cost more in thread handoff than they save
+    const std::size_t MIN_SLICE_SIZE = 64 * 1024;
+    const char* data = m_scanner->Data();
+    std::size_t length = m_scanner->Length();
+    if (threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+    }
+    if (threadCount <= 1 || length < 2 * MIN_SLICE_SIZE || length > UINT32_MAX) {
+        return Parse();
+    }
+    std::vector<uint32_t> structurals;
+    util::BuildStructuralIndex(data, length, structurals);
+    if (structurals.empty() || data[structurals[0]] != '[') {
+        return Parse();
+    }
+
+    // cut the top level array at commas into slices of about equal size
+    std::size_t sliceCount = std::min(threadCount * 4, length / MIN_SLICE_SIZE);
+    std::size_t sliceSize = length / sliceCount;
+    std::vector<std::pair<std::size_t, std::size_t>> slices;
+    std::size_t sliceBegin = structurals[0] + 1;
+    std::size_t depth = 0;
+    std::size_t index = 0;
+    for (; index < structurals.size(); ++index) {
+        std::size_t pos = structurals[index];
+        char ch = data[pos];
+        if (ch == '[' || ch == '{') {
+            depth++;
+        } else if (ch == ']' || ch == '}') {
+            if (--depth == 0) {
+                slices.emplace_back(sliceBegin, pos);
+                break;
+            }
+        } else if (ch == ',' && depth == 1 && pos - sliceBegin >= sliceSize) {
+            slices.emplace_back(sliceBegin, pos);
+            sliceBegin = pos + 1;
+        }
+    }
+    // unbalanced or trailing tokens, let Parse() report it
+    if (depth != 0 || index + 1 != structurals.size() || slices.size() < 2) {
+        return Parse();
+    }
+
+    std::vector<JsonArray> parts(slices.size());
+    std::vector<std::exception_ptr> errors(slices.size());
+    std::atomic<std::size_t> next(0);
+    auto work = [&]() {
+        for (std::size_t i = next++; i < slices.size(); i = next++) {
+            try {
+                JsonParser parser(data + slices[i].first, slices[i].second - slices[i].first);
+                parts[i] = parser.ParseJsonArraySlice();
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    workers.reserve(threadCount < slices.size() ? threadCount : slices.size());
+    for (std::size_t i = 1; i < threadCount && i < slices.size(); ++i) {
+        try {
+            workers.emplace_back(work);
+        } catch (const std::system_error&) {
+            // out of threads, the started workers and this thread share the remaining slices
+            break;
+        }
+    }
+    work();
+    for (std::thread& worker: workers) {
+        worker.join();
+    }
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < parts.size(); ++i) {
+        if (errors[i]) {
+            return Parse();
+        }
+        total += parts[i].size();
+    }
+    JsonArray array {};
+    array.reserve(total);
+    for (JsonArray& part: parts) {
+        std::move(part.begin(), part.end(), std::back_inserter(array));
+    }
+    return JsonElement(std::move(array));
+}
+
+JsonArray JsonParser::ParseJsonArraySlice()
+{
+    JsonArray array {};
+    m_scanner->Reset();
+    m_depth = 1; // the slice lives inside the top level array
+    m_members.clear();
+    while (true) {
+        array.push_back(ParseNext());
+        size_t pos = m_scanner->Position();
+        JsonScanner::Token token = m_scanner->Next();
+        if (token == JsonScanner::Token::EOF_TOKEN) {
+            break;
+        }
+        if (token != JsonScanner::Token::COMMA) {
+            Panic("expect ',' in array, pos: %lu", pos);
+        }
+    }
+    return array;
+}
+
+bool JsonParser::Parse(JsonHandler& handler)
+{
+    m_scanner->Reset();
+    m_depth = 0;
+    if (!ParseNext(handler)) {
+        return false;
+    }
+    if (m_scanner->Next() != JsonScanner::Token::EOF_TOKEN) {
+        Panic("json scanner reached non-eof token, position = %lu", m_scanner->Position());
+    }
+    return true;
+}
+
+bool JsonParser::ParseNext(JsonHandler& handler)
+{
+    JsonScanner::Token token = m_scanner->Next();
+    switch (token) {
+        case JsonScanner::Token::OBJECT_BEGIN: {
+            EnterContainer();
+            bool ok = ParseJsonObject(handler);
+            m_depth--;
+            return ok;
+        }
+        case JsonScanner::Token::ARRAY_BEGIN: {
+            EnterContainer();
+            bool ok = ParseJsonArray(handler);
+            m_depth--;
+            return ok;
+        }
+        case JsonScanner::Token::STRING: {
+            const std::string& str = m_scanner->GetStringValue();
+            return handler.String(str.data(), str.size());
+        }
+        case JsonScanner::Token::NUMBER: {
+            return m_scanner->IsNumberLongInt() ?
+                handler.Int64(m_scanner->GetLongIntValue()) : handler.Double(m_scanner->GetDoubleValue());
+        }
+        case JsonScanner::Token::LITERAL_TRUE: {
+            return handler.Bool(true);
+        }
+        case JsonScanner::Token::LITERAL_FALSE: {
+            return handler.Bool(false);
+        }
+        case JsonScanner::Token::LITERAL_NULL: {
+            return handler.Null();
+        }
+        case JsonScanner::Token::WHITESPACE:
+        case JsonScanner::Token::COMMA:
+        case JsonScanner::Token::COLON:
+        case JsonScanner::Token::ARRAY_END:
+        case JsonScanner::Token::OBJECT_END:
+        case JsonScanner::Token::EOF_TOKEN:
+        default : Panic("scanner return unexpected token: %s", JsonScanner::TokenName(token).c_str());
+    }
+    return false;
+}
+
+bool JsonParser::ParseJsonObject(JsonHandler& handler)
+{
+    if (!handler.StartObject()) {
+        return false;
+    }
+    std::size_t memberCount = 0;
+    JsonScanner::Token token = m_scanner->Next();
+    if (token == JsonScanner::Token::OBJECT_END) {
+        return handler.EndObject(memberCount);
+    }
+    m_scanner->RollBack();
+
+    while (true) {
+        size_t pos = m_scanner->Position();
+        token = m_scanner->Next();
+        if (token != JsonScanner::Token::STRING) {
+            Panic("expect a string as key for json object, position: %lu", pos);
+        }
+        const std::string& key = m_scanner->GetStringValue();
+        if (!handler.Key(key.data(), key.size())) {
+            return false;
+        }
+
+        pos = m_scanner->Position();
+        token = m_scanner->Next();
+        if (token != JsonScanner::Token::COLON) {
+            Panic("expect ':' in json object, position: %lu", pos);
+        }
+        if (!ParseNext(handler)) {
+            return false;
+        }
+        memberCount++;
+
+        pos = m_scanner->Position();
+        token = m_scanner->Next();
+        if (token == JsonScanner::Token::OBJECT_END) {
+            break;
+        }
+        if (token != JsonScanner::Token::COMMA) {
+            Panic("expect ',' in json object, position: %lu", pos);
+        }
+    }
+    return handler.EndObject(memberCount);
+}
+
+bool JsonParser::ParseJsonArray(JsonHandler& handler)
+{
+    if (!handler.StartArray()) {
+        return false;
+    }
+    std::size_t elementCount = 0;
+    JsonScanner::Token token = m_scanner->Next();
+    if (token == JsonScanner::Token::ARRAY_END) {
+        return handler.EndArray(elementCount);
+    }
+    m_scanner->RollBack();
+
+    while (true) {
+        if (!ParseNext(handler)) {
+            return false;
+        }
+        elementCount++;
+        size_t pos = m_scanner->Position();
+        token = m_scanner->Next();
+        if (token == JsonScanner::Token::ARRAY_END) {
+            break;
+        }
+        if (token != JsonScanner::Token::COMMA) {
+            Panic("expect ',' in array, pos: %lu", pos);
+        }
+    }
+    return handler.EndArray(elementCount);
+}
+
+JsonReader::JsonReader(const std::string& str)
+{
+    m_scanner = new JsonScanner(str.data(), str.size());
+}
+
+JsonReader::JsonReader(const char* data, std::size_t length)
+{
+    m_scanner = new JsonScanner(data, length);
+}
+
+JsonReader::~JsonReader()
+{
+    if (m_scanner != nullptr) {
+        delete m_scanner;
+        m_scanner = nullptr;
+    }
+}
+
+JsonElement::Type JsonReader::PeekType()
+{
+    std::size_t pos = util::SkipWhitespace(m_scanner->Data(), m_scanner->Position(), m_scanner->Length());
+    if (pos >= m_scanner->Length()) {
+        Panic("unexpected end of json, position: %lu", pos);
+    }
+    char ch = m_scanner->Data()[pos];
+    switch (ch) {
+        case '{': return JsonElement::Type::JSON_OBJECT;
+        case '[': return JsonElement::Type::JSON_ARRAY;
+        case '\"': return JsonElement::Type::JSON_STRING;
+        case 't':
+        case 'f': return JsonElement::Type::JSON_BOOL;
+        case 'n': return JsonElement::Type::JSON_NULL;
+        default: break;
+    }
+    bool isLongInt = true;
+    int64_t longValue = 0;
+    double doubleValue = 0;
+    if ((ch == '-' || ('0' <= ch && ch <= '9'))
+        && util::ScanNumber(m_scanner->Data(), m_scanner->Length(), pos, isLongInt, longValue, doubleValue)) {
+        return isLongInt ? JsonElement::Type::JSON_NUMBER_LONG : JsonElement::Type::JSON_NUMBER_DOUBLE;
+    }
+    Panic("expect a json value, position: %lu", m_scanner->Position());
+    return JsonElement::Type::JSON_NULL;
+}
+
+void JsonReader::StartObject()
+{
+    std::size_t pos = m_scanner->Position();
+    if (m_scanner->Next() != JsonScanner::Token::OBJECT_BEGIN) {
+        Panic("expect '{' to read a json object, position: %lu", pos);
+    }
+    EnterContainer();
+}
+
+bool JsonReader::NextMember(std::string& key)
+{
+    if (!NextInContainer(true)) {
+        return false;
+    }
+    std::size_t pos = m_scanner->Position();
+    if (m_scanner->Next() != JsonScanner::Token::STRING) {
+        Panic("expect a string as key for json object, position: %lu", pos);
+    }
+    key.assign(m_scanner->GetStringValue());
+    pos = m_scanner->Position();
+    if (m_scanner->Next() != JsonScanner::Token::COLON) {
+        Panic("expect ':' in json object, position: %lu", pos);
+    }
+    return true;
+}
+
+void JsonReader::StartArray()
+{
+    std::size_t pos = m_scanner->Position();
+    if (m_scanner->Next() != JsonScanner::Token::ARRAY_BEGIN) {
+        Panic("expect '[' to read a json array, position: %lu", pos);
+    }
+    EnterContainer();
+}
+
+bool JsonReader::NextElement()
+{
+    return NextInContainer(false);
+}
+
+bool JsonReader::ReadBool()
+{
+    std::size_t pos = m_scanner->Position();
+    JsonScanner::Token token = m_scanner->Next();
+    if (token != JsonScanner::Token::LITERAL_TRUE && token != JsonScanner::Token::LITERAL_FALSE) {
+        Panic("expect a bool, position: %lu", pos);
+    }
+    return token == JsonScanner::Token::LITERAL_TRUE;
+}
+
+int64_t JsonReader::ReadLongInt()
+{
+    std::size_t pos = m_scanner->Position();
+    if (m_scanner->Next() != JsonScanner::Token::NUMBER) {
+        Panic("expect a number, position: %lu", pos);
+    }
+    if (m_scanner->IsNumberLongInt()) {
+        return m_scanner->GetLongIntValue();
+    }
+    return util::DoubleToLongInt(m_scanner->GetDoubleValue());
+}
+
+double JsonReader::ReadDouble()
+{
+    std::size_t pos = m_scanner->Position();
+    if (m_scanner->Next() != JsonScanner::Token::NUMBER) {
+        Panic("expect a number, position: %lu", pos);
+    }
+    if (m_scanner->IsNumberLongInt()) {
+        return static_cast<double>(m_scanner->GetLongIntValue());
+    }
+    return m_scanner->GetDoubleValue();
+}
+
+void JsonReader::ReadString(std::string& str)
+{
+    std::size_t pos = m_scanner->Position();
+    if (m_scanner->Next() != JsonScanner::Token::STRING) {
+        Panic("expect a string, position: %lu", pos);
+    }
+    str.assign(m_scanner->GetStringValue());
+}
+
+std::string JsonReader::ReadString()
+{
+    std::string str;
+    ReadString(str);
+    return str;
+}
+
+void JsonReader::ReadNull()
+{
+    std::size_t pos = m_scanner->Position();
+    if (m_scanner->Next() != JsonScanner::Token::LITERAL_NULL) {
+        Panic("expect null, position: %lu", pos);
+    }
+}
+
+void JsonReader::SkipValue()
+{
+    std::size_t pos = m_scanner->Position();
+    switch (m_scanner->Next()) {
+        case JsonScanner::Token::OBJECT_BEGIN: {
+            std::string key;
+            EnterContainer();
+            while (NextMember(key)) {
+                SkipValue();
+            }
+            return;
+        }
+        case JsonScanner::Token::ARRAY_BEGIN: {
+            EnterContainer();
+            while (NextElement()) {
+                SkipValue();
+            }
+            return;
+        }
+        case JsonScanner::Token::STRING:
+        case JsonScanner::Token::NUMBER:
+        case JsonScanner::Token::LITERAL_TRUE:
+        case JsonScanner::Token::LITERAL_FALSE:
+        case JsonScanner::Token::LITERAL_NULL:
+            return;
+        default:
+            Panic("expect a json value, position: %lu", pos);
+    }
+}
+
+void JsonReader::Finish()
+{
+    if (m_scanner->Next() != JsonScanner::Token::EOF_TOKEN) {
+        Panic("json scanner reached non-eof token, position = %lu", m_scanner->Position());
+    }
+}
+
+/*
+ * consume the separator before the next member or element, or the closing bracket.
+ * the container that holds the one just closed has at least one value, so m_first is cleared in both cases
+ */
+bool JsonReader::NextInContainer(bool isObject)
+{
+    std::size_t pos = m_scanner->Position();
+    JsonScanner::Token token = m_scanner->Next();
+    if (token == (isObject ? JsonScanner::Token::OBJECT_END : JsonScanner::Token::ARRAY_END)) {
+        m_first = false;
+        m_depth--;
+        return false;
+    }
+    if (m_first) {
+        m_scanner->RollBack();
+    } else if (token != JsonScanner::Token::COMMA) {
+        Panic("expect ',' in json %s, position: %lu", isObject ? "object" : "array", pos);
+    }
+    m_first = false;
+    return true;
+}
+
+// called right after an opening bracket, SkipValue and nested types would otherwise recurse without bound
+void JsonReader::EnterContainer()
+{
+    if (m_depth >= JsonParser::MAX_DEPTH) {
+        Panic("json nesting exceeds %lu levels, position: %lu", JsonParser::MAX_DEPTH, m_scanner->Position());
+    }
+    m_depth++;
+    m_first = true;
+}
+
+void JsonFieldTable::Add(const char* key, ReadFunc read, WriteFunc write, std::size_t offset)
+{
+    std::size_t length = std::strlen(key);
+    std::size_t first = Search(key, length);
+    if (first != NO_FIELD) {
+        m_fields[first].last = m_fields.size();
+    }
+    m_fields.push_back(Entry { first != NO_FIELD ? nullptr : key, length, read, write, offset, m_fields.size() });
+    if (m_fields.size() > INDEX_THRESHOLD) {
+        RebuildIndex();
+    }
+}
+
+std::size_t JsonFieldTable::Find(const std::string& key, std::size_t hint) const
+{
+    if (hint < m_fields.size()) {
+        const Entry& entry = m_fields[hint];
+        if (entry.key != nullptr && entry.length == key.size() && std::memcmp(entry.key, key.data(), key.size()) == 0) {
+            return hint;
+        }
+    }
+    return Search(key.data(), key.size());
+}
+
+bool JsonFieldTable::Read(std::size_t field, JsonReader& reader, void* object) const
+{
+    const Entry& entry = m_fields[field];
+    if (entry.read == nullptr) {
+        return false;
+    }
+    entry.read(reader, static_cast<char*>(object) + entry.offset);
+    return true;
+}
+
+bool JsonFieldTable::WriteLastRepeat(std::size_t field, JsonWriter& writer, const void* object) const
+{
+    const Entry& last = m_fields[m_fields[field].last];
+    if (m_fields[field].last == field) {
+        return false;
+    }
+    if (last.write == nullptr) {
+        // a static or reference member repeating the key, written in place as a best effort
+        return false;
+    }
+    last.write(writer, static_cast<const char*>(object) + last.offset);
+    return true;
+}
+
+std::size_t JsonFieldTable::Search(const char* key, std::size_t length) const
+{
+    if (m_index.empty()) {
+        for (std::size_t pos = 0; pos < m_fields.size(); ++pos) {
+            const Entry& entry = m_fields[pos];
+            if (entry.key != nullptr && entry.length == length && std::memcmp(entry.key, key, length) == 0) {
+                return pos;
+            }
+        }
+        return NO_FIELD;
+    }
+    std::size_t mask = m_index.size() - 1;
+    for (std::size_t slot = HashKey(key, length) & mask; m_index[slot] != 0; slot = (slot + 1) & mask) {
+        const Entry& entry = m_fields[m_index[slot] - 1];
+        if (entry.length == length && std::memcmp(entry.key, key, length) == 0) {
+            return m_index[slot] - 1;
+        }
+    }
+    return NO_FIELD;
+}
+
+/*
+ * tables only grow while the type is first visited, so the index is simply rebuilt at four times the field count
+ */
+void JsonFieldTable::RebuildIndex()
+{
+    std::size_t capacity = 16;
+    while (capacity < m_fields.size() * 4) {
+        capacity *= 2;
+    }
+    m_index.assign(capacity, 0);
+    std::size_t mask = capacity - 1;
+    for (std::size_t pos = 0; pos < m_fields.size(); ++pos) {
+        const Entry& entry = m_fields[pos];
+        if (entry.key == nullptr) {
+            continue;
+        }
+        std::size_t slot = HashKey(entry.key, entry.length) & mask;
+        while (m_index[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        m_index[slot] = static_cast<uint32_t>(pos + 1);
+    }
+}
+
+bool JsonElementBuilder::StartObject()
+{
+    m_stack.push_back(JsonElement(JsonElement::Type::JSON_OBJECT));
+    return true;
+}
+
+bool JsonElementBuilder::Key(const char* key, std::size_t length)
+{
+    m_keys.emplace_back(key, length);
+    return true;
+}
+
+bool JsonElementBuilder::EndObject(std::size_t)
+{
+    return EndContainer();
+}
+
+bool JsonElementBuilder::StartArray()
+{
+    m_stack.push_back(JsonElement(JsonElement::Type::JSON_ARRAY));
+    return true;
+}
+
+bool JsonElementBuilder::EndArray(std::size_t)
+{
+    return EndContainer();
+}
+
+bool JsonElementBuilder::String(const char* str, std::size_t length)
+{
+    return Add(JsonElement(std::string(str, length)));
+}
+
+bool JsonElementBuilder::Int64(int64_t value)
+{
+    return Add(JsonElement(value));
+}
+
+bool JsonElementBuilder::Double(double value)
+{
+    return Add(JsonElement(value));
+}
+
+bool JsonElementBuilder::Bool(bool value)
+{
+    return Add(JsonElement(value));
+}
+
+bool JsonElementBuilder::Null()
+{
+    return Add(JsonElement());
+}
+
+JsonElement& JsonElementBuilder::Root()
+{
+    return m_root;
+}
+
+void JsonElementBuilder::Reset()
+{
+    m_stack.clear();
+    m_keys.clear();
+    m_root = JsonElement();
+}
+
+bool JsonElementBuilder::Add(JsonElement&& element)
+{
+    if (m_stack.empty()) {
+        m_root = std::move(element);
+        return true;
+    }
+    JsonElement& parent = m_stack.back();
+    if (parent.IsJsonObject()) {
+        parent.AsJsonObject()[std::move(m_keys.back())] = std::move(element);
+        m_keys.pop_back();
+    } else {
+        parent.AsJsonArray().push_back(std::move(element));
+    }
+    return true;
+}
+
+bool JsonElementBuilder::EndContainer()
+{
+    JsonElement container = std::move(m_stack.back());
+    m_stack.pop_back();
+    return Add(std::move(container));
+}
+
+JsonPushParser::JsonPushParser() : m_builder(new JsonElementBuilder())
+{
+    m_handler = m_builder;
+}
+
+JsonPushParser::JsonPushParser(JsonHandler& handler) : m_handler(&handler)
+{}
+
+JsonPushParser::~JsonPushParser()
+{
+    delete m_builder;
+    m_builder = nullptr;
+}
+
+JsonPushParser::Status JsonPushParser::Feed(const std::string& chunk)
+{
+    return Feed(chunk.data(), chunk.size());
+}
+
+JsonPushParser::Status JsonPushParser::Feed(const char* data, std::size_t length)
+{
+    std::size_t pos = 0;
+    while (pos < length && m_status == Status::NEED_MORE) {
+        switch (m_lexState) {
+            case LexState::STRING: {
+                pos = FeedString(data, pos, length);
+                break;
+            }
+            case LexState::NUMBER: {
+                std::size_t runEnd = pos;
+                while (runEnd < length && (('0' <= data[runEnd] && data[runEnd] <= '9') || data[runEnd] == '-'
+                    || data[runEnd] == '+' || data[runEnd] == '.' || data[runEnd] == 'e' || data[runEnd] == 'E')) {
+                    runEnd++;
+                }
+                m_token.append(data + pos, runEnd - pos);
+                pos = runEnd;
+                if (pos < length) {
+                    // the delimiter is handled as the start of the next token
+                    FinishNumber();
+                }
+                break;
+            }
+            case LexState::LITERAL: {
+                if (data[pos] != m_literal[m_token.size()]) {
+                    Panic("unknown literal token at position = %lu, do you mean: %s ?", m_tokenPosition, m_literal);
+                }
+                m_token.push_back(data[pos++]);
+                if (m_token.size() == m_literalLength) {
+                    FinishLiteral();
+                }
+                break;
+            }
+            case LexState::NONE: {
+                char ch = data[pos];
+                if (ch != ' ' && ch != '\n' && ch != '\r' && ch != '\t') {
+                    StartToken(ch, m_consumed + pos);
+                }
+                pos++;
+                break;
+            }
+        }
+    }
+    m_consumed += pos;
+    return m_status;
+}
+
+JsonPushParser::Status JsonPushParser::Finish()
+{
+    if (m_status == Status::NEED_MORE && m_lexState == LexState::NUMBER) {
+        FinishNumber();
+    }
+    if (m_status == Status::NEED_MORE) {
+        Panic("unexpected end of json input, position: %lu", m_consumed);
+    }
+    return m_status;
+}
+
+std::size_t JsonPushParser::Consumed() const
+{
+    return m_consumed;
+}
+
+JsonElement& JsonPushParser::Result()
+{
+    if (m_builder == nullptr) {
+        Panic("no result is built when events go to a handler");
+    }
+    if (m_status != Status::COMPLETE) {
+        Panic("json value is not complete, position: %lu", m_consumed);
+    }
+    return m_builder->Root();
+}
+
+void JsonPushParser::Reset()
+{
+    if (m_builder != nullptr) {
+        m_builder->Reset();
+    }
+    m_status = Status::NEED_MORE;
+    m_lexState = LexState::NONE;
+    m_expect = Expect::VALUE;
+    m_stack.clear();
+    m_token.clear();
+    m_escaped = false;
+    m_literal = nullptr;
+    m_literalLength = 0;
+    m_tokenPosition = 0;
+    m_consumed = 0;
+}
+
+// append the raw string text up to and including the closing quote, return the position after what was consumed
+std::size_t JsonPushParser::FeedString(const char* data, std::size_t pos, std::size_t length)
+{
+    while (pos < length) {
+        if (m_escaped) {
+            m_token.push_back(data[pos++]);
+            m_escaped = false;
+            continue;
+        }
+        std::size_t runEnd = util::FindQuoteOrBackslash(data, pos, length);
+        m_token.append(data + pos, runEnd - pos);
+        pos = runEnd;
+        if (pos >= length) {
+            break;
+        }
+        char ch = data[pos++];
+        m_token.push_back(ch);
+        if (ch == '\\') {
+            m_escaped = true;
+            continue;
+        }
+        FinishString();
+        break;
+    }
+    return pos;
+}
+
+void JsonPushParser::StartToken(char ch, std::size_t position)
+{
+    m_tokenPosition = position;
+    if (ch == '\"') {
+        if (m_expect != Expect::KEY && m_expect != Expect::KEY_OR_OBJECT_END) {
+            BeginValue(position);
+        }
+        m_lexState = LexState::STRING;
+        m_token.assign(1, ch);
+        m_escaped = false;
+        return;
+    }
+    if (('0' <= ch && ch <= '9') || ch == '-') {
+        BeginValue(position);
+        m_lexState = LexState::NUMBER;
+        m_token.assign(1, ch);
+        return;
+    }
+    switch (ch) {
+        case 't':
+            m_literal = "true";
+            m_literalLength = 4;
+            break;
+        case 'f':
+            m_literal = "false";
+            m_literalLength = 5;
+            break;
+        case 'n':
+            m_literal = "null";
+            m_literalLength = 4;
+            break;
+        default:
+            Punctuation(ch, position);
+            return;
+    }
+    BeginValue(position);
+    m_lexState = LexState::LITERAL;
+    m_token.assign(1, ch);
+}
+
+void JsonPushParser::FinishString()
+{
+    m_lexState = LexState::NONE;
+    // the complete token is decoded by the regular scanner, so escapes behave exactly like JsonParser
+    JsonScanner scanner(m_token.data(), m_token.size());
+    scanner.Next();
+    const std::string& str = scanner.GetStringValue();
+    if (m_expect == Expect::KEY || m_expect == Expect::KEY_OR_OBJECT_END) {
+        m_expect = Expect::COLON;
+        if (!m_handler->Key(str.data(), str.size())) {
+            m_status = Status::STOPPED;
+        }
+        return;
+    }
+    EndValue(m_handler->String(str.data(), str.size()));
+}
+
+void JsonPushParser::FinishNumber()
+{
+    m_lexState = LexState::NONE;
+    std::size_t pos = 0;
+    bool isLongInt = false;
+    int64_t longValue = 0;
+    double doubleValue = 0;
+    if (!util::ScanNumber(m_token.data(), m_token.size(), pos, isLongInt, longValue, doubleValue)
+        || pos != m_token.size()) {
+        Panic("invalid number at position %lu", m_tokenPosition);
+    }
+    EndValue(isLongInt ? m_handler->Int64(longValue) : m_handler->Double(doubleValue));
+}
+
+void JsonPushParser::FinishLiteral()
+{
+    m_lexState = LexState::NONE;
+    switch (m_literal[0]) {
+        case 't':
+            EndValue(m_handler->Bool(true));
+            return;
+        case 'f':
+            EndValue(m_handler->Bool(false));
+            return;
+        default:
+            EndValue(m_handler->Null());
+            return;
+    }
+}
+
+void JsonPushParser::Punctuation(char ch, std::size_t position)
+{
+    switch (ch) {
+        case '{':
+        case '[': {
+            BeginValue(position);
+            // the default builder would otherwise produce a tree too deep to destroy without overflowing the stack
+            if (m_stack.size() >= JsonParser::MAX_DEPTH) {
+                Panic("json nesting exceeds %lu levels, position: %lu", JsonParser::MAX_DEPTH, position);
+            }
+            m_stack.push_back(Frame { ch, 0 });
+            m_expect = (ch == '{') ? Expect::KEY_OR_OBJECT_END : Expect::VALUE_OR_ARRAY_END;
+            if (!(ch == '{' ? m_handler->StartObject() : m_handler->StartArray())) {
+                m_status = Status::STOPPED;
+            }
+            return;
+        }
+        case '}':
+        case ']': {
+            char open = (ch == '}') ? '{' : '[';
+            Expect emptyExpect = (ch == '}') ? Expect::KEY_OR_OBJECT_END : Expect::VALUE_OR_ARRAY_END;
+            if (m_stack.empty() || m_stack.back().type != open
+                || (m_expect != emptyExpect && m_expect != Expect::COMMA_OR_END)) {
+                Panic("unexpected '%c', position: %lu", ch, position);
+            }
+            std::size_t count = m_stack.back().count;
+            m_stack.pop_back();
+            EndValue(ch == '}' ? m_handler->EndObject(count) : m_handler->EndArray(count));
+            return;
+        }
+        case ',': {
+            if (m_expect != Expect::COMMA_OR_END) {
+                Panic("unexpected ',', position: %lu", position);
+            }
+            m_expect = (m_stack.back().type == '{') ? Expect::KEY : Expect::VALUE;
+            return;
+        }
+        case ':': {
+            if (m_expect != Expect::COLON) {
+                Panic("expect ':' in json object, position: %lu", position);
+            }
+            m_expect = Expect::VALUE;
+            return;
+        }
+        default: Panic("Invalid token at position %lu", position);
+    }
+}
+
+void JsonPushParser::BeginValue(std::size_t position)
+{
+    if (m_expect != Expect::VALUE && m_expect != Expect::VALUE_OR_ARRAY_END) {
+        Panic("unexpected value, position: %lu", position);
+    }
+}
+
+void JsonPushParser::EndValue(bool handlerResult)
+{
+    if (!handlerResult) {
+        m_status = Status::STOPPED;
+        return;
+    }
+    if (m_stack.empty()) {
+        m_expect = Expect::DONE;
+        m_status = Status::COMPLETE;
+        return;
+    }
+    m_stack.back().count++;
+    m_expect = Expect::COMMA_OR_END;
+}
+
+namespace {
+    // a run of whole lines, parsed by one worker
+    struct JsonLinesBatch {
+        std::size_t index = 0;
+        std::size_t offset = 0; // input offset of data[0]
+        const char* data { nullptr };
+        std::size_t length = 0;
+        std::string owned {}; // stream input keeps the text of its batch here
+        std::vector<std::pair<std::size_t, JsonElement>> records {};
+        std::exception_ptr error {};
+    };
+
+    void ParseJsonLinesBatch(JsonLinesBatch& batch)
+    {
+        try {
+            std::size_t pos = 0;
+            while (pos < batch.length) {
+                const void* newline = std::memchr(batch.data + pos, '\n', batch.length - pos);
+                std::size_t end = newline != nullptr ? static_cast<const char*>(newline) - batch.data : batch.length;
+                std::size_t lineLength = end - pos;
+                if (lineLength > 0 && batch.data[pos + lineLength - 1] == '\r') {
+                    lineLength--;
+                }
+                std::size_t first = pos;
+                while (first < pos + lineLength && (batch.data[first] == ' ' || batch.data[first] == '\t')) {
+                    first++;
+                }
+                if (first < pos + lineLength) {
+                    try {
+                        JsonParser parser(batch.data + pos, lineLength);
+                        batch.records.emplace_back(batch.offset + pos, parser.Parse());
+                    } catch (const std::logic_error& e) {
+                        Panic("invalid json record at offset %lu: %.400s", batch.offset + pos, e.what());
+                    }
+                }
+                pos = end + 1;
+            }
+        } catch (...) {
+            batch.error = std::current_exception();
+        }
+    }
+
+    // worker threads parsing submitted batches, joined on destruction even if the caller throws
+    class JsonLinesPool {
+        public:
+            explicit JsonLinesPool(std::size_t threadCount)
+            {
+                m_workers.reserve(threadCount);
+                try {
+                    for (std::size_t i = 0; i < threadCount; ++i) {
+                        m_workers.emplace_back(&JsonLinesPool::Work, this);
+                    }
+                } catch (...) {
+                    // the destructor does not run for a throwing constructor, stop the workers already started
+                    Stop();
+                    throw;
+                }
+            }
+
+            JsonLinesPool(const JsonLinesPool&) = delete;
+            JsonLinesPool& operator = (const JsonLinesPool&) = delete;
+
+            ~JsonLinesPool()
+            {
+                Stop();
+            }
+
+            void Submit(std::unique_ptr<JsonLinesBatch> batch)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_pending.push_back(std::move(batch));
+                }
+                m_pendingCondition.notify_one();
+            }
+
+            // wait for the batch with the given index, or for any finished batch if not ordered
+            std::unique_ptr<JsonLinesBatch> Take(bool ordered, std::size_t index)
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_doneCondition.wait(lock, [&]() {
+                    return ordered ? m_done.count(index) != 0 : !m_done.empty();
+                });
+                auto it = ordered ? m_done.find(index) : m_done.begin();
+                std::unique_ptr<JsonLinesBatch> batch = std::move(it->second);
+                m_done.erase(it);
+                return batch;
+            }
+
+        private:
+            void Stop()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_stop = true;
+                }
+                m_pendingCondition.notify_all();
+                for (std::thread& worker: m_workers) {
+                    worker.join();
+                }
+            }
+
+            void Work()
+            {
+                while (true) {
+                    std::unique_ptr<JsonLinesBatch> batch;
+                    {
+                        std::unique_lock<std::mutex> lock(m_mutex);
+                        m_pendingCondition.wait(lock, [&]() { return m_stop || !m_pending.empty(); });
+                        if (m_stop) {
+                            return;
+                        }
+                        batch = std::move(m_pending.front());
+                        m_pending.pop_front();
+                    }
+                    ParseJsonLinesBatch(*batch);
+                    {
+                        std::lock_guard<std::mutex> lock(m_mutex);
+                        std::size_t index = batch->index;
+                        m_done[index] = std::move(batch);
+                    }
+                    m_doneCondition.notify_all();
+                }
+            }
+
+        private:
+            std::mutex m_mutex;
+            std::condition_variable m_pendingCondition;
+            std::condition_variable m_doneCondition;
+            std::deque<std::unique_ptr<JsonLinesBatch>> m_pending;
+            std::map<std::size_t, std::unique_ptr<JsonLinesBatch>> m_done;
+            std::vector<std::thread> m_workers;
+            bool m_stop = false;
+    };
+
+    // fill the next batch, return false at the end of the input
+    using JsonLinesSource = std::function<bool(JsonLinesBatch&)>;
+
+    std::size_t RunJsonLines(std::size_t threadCount, bool ordered,
+        const JsonLinesSource& source, const JsonLinesReader::Callback& callback)
+    {
+        JsonLinesPool pool(threadCount);
+        const std::size_t window = threadCount * 2;
+        std::size_t submitted = 0;
+        std::size_t delivered = 0;
+        std::size_t records = 0;
+        bool more = true;
+        while (true) {
+            while (more && submitted - delivered < window) {
+                std::unique_ptr<JsonLinesBatch> batch(new JsonLinesBatch());
+                batch->index = submitted;
+                more = source(*batch);
+                if (more) {
+                    pool.Submit(std::move(batch));
+                    submitted++;
+                }
+            }
+            if (delivered == submitted) {
+                break;
+            }
+            std::unique_ptr<JsonLinesBatch> batch = pool.Take(ordered, delivered);
+            delivered++;
+            if (batch->error) {
+                std::rethrow_exception(batch->error);
+            }
+            for (auto& record: batch->records) {
+                callback(record.first, record.second);
+            }
+            records += batch->records.size();
+        }
+        return records;
+    }
+}
+
+JsonLinesReader::JsonLinesReader(std::size_t threadCount) : m_threadCount(threadCount)
+{
+    if (m_threadCount == 0) {
+        m_threadCount = std::thread::hardware_concurrency();
+    }
+    if (m_threadCount == 0) {
+        m_threadCount = 1;
+    }
+}
+
+void JsonLinesReader::SetOrdered(bool ordered)
+{
+    m_ordered = ordered;
+}
+
+void JsonLinesReader::SetBatchSize(std::size_t bytes)
+{
+    m_batchSize = bytes == 0 ? 1 : bytes;
+}
+
+std::size_t JsonLinesReader::ThreadCount() const
+{
+    return m_threadCount;
+}
+
+std::size_t JsonLinesReader::Read(const char* data, std::size_t length, const Callback& callback)
+{
+    std::size_t offset = 0;
+    std::size_t batchSize = m_batchSize;
+    JsonLinesSource source = [&](JsonLinesBatch& batch) {
+        if (offset >= length) {
+            return false;
+        }
+        // extend the batch to the end of its last line
+        std::size_t end = length - offset > batchSize ? offset + batchSize : length;
+        if (end < length) {
+            const void* newline = std::memchr(data + end, '\n', length - end);
+            end = newline != nullptr ? static_cast<const char*>(newline) - data + 1 : length;
+        }
+        batch.offset = offset;
+        batch.data = data + offset;
+        batch.length = end - offset;
+        offset = end;
+        return true;
+    };
+    return RunJsonLines(m_threadCount, m_ordered, source, callback);
+}
+
+std::size_t JsonLinesReader::Read(std::istream& stream, const Callback& callback)
+{
+    std::size_t offset = 0;
+    std::size_t batchSize = m_batchSize;
+    std::string carry; // partial line after the last newline of the previous batch
+    bool eof = false;
+    JsonLinesSource source = [&](JsonLinesBatch& batch) {
+        std::string text = std::move(carry);
+        carry.clear();
+        while (!eof) {
+            std::size_t size = text.size();
+            text.resize(size + batchSize);
+            stream.read(&text[size], static_cast<std::streamsize>(batchSize));
+            std::size_t count = static_cast<std::size_t>(stream.gcount());
+            text.resize(size + count);
+            eof = count < batchSize;
+            std::size_t newline = text.rfind('\n');
+            if (newline != std::string::npos) {
+                carry.assign(text, newline + 1, std::string::npos);
+                text.resize(newline + 1);
+                break;
+            }
+        }
+        if (text.empty()) {
+            return false;
+        }
+        batch.owned = std::move(text);
+        batch.offset = offset;
+        batch.data = batch.owned.data();
+        batch.length = batch.owned.size();
+        offset += batch.length;
+        return true;
+    };
+    return RunJsonLines(m_threadCount, m_ordered, source, callback);
+}
+
+std::size_t JsonLinesReader::ReadFile(const std::string& path, const Callback& callback)
+{
+    FileBuffer file(path);
+    return Read(file.Data(), file.Size(), callback);
+}
+
+JsonHandler::~JsonHandler()
+{}
+
+bool JsonHandler::StartObject() { return true; }
+
+bool JsonHandler::Key(const char*, std::size_t) { return true; }
+
+bool JsonHandler::EndObject(std::size_t) { return true; }
+
+bool JsonHandler::StartArray() { return true; }
+
+bool JsonHandler::EndArray(std::size_t) { return true; }
+
+bool JsonHandler::String(const char*, std::size_t) { return true; }
+
+bool JsonHandler::Int64(int64_t) { return true; }
+
+bool JsonHandler::Double(double) { return true; }
+
+bool JsonHandler::Bool(bool) { return true; }
+
+bool JsonHandler::Null() { return true; }
+
+JsonArena::JsonArena(std::size_t blockSize): m_blockSize(blockSize)
+{}
+
+JsonArena::~JsonArena()
+{
+    for (const Block& block: m_blocks) {
+        std::free(block.data);
+    }
+    m_blocks.clear();
+}
+
+void* JsonArena::Allocate(std::size_t size, std::size_t alignment)
+{
+    if (size == 0) {
+        return nullptr;
+    }
+    while (m_current < m_blocks.size()) {
+        const Block& block = m_blocks[m_current];
+        std::size_t aligned = (m_offset + alignment - 1) & ~(alignment - 1);
+        if (aligned + size <= block.size) {
+            m_offset = aligned + size;
+            return block.data + aligned;
+        }
+        m_current++;
+        m_offset = 0;
+    }
+    // malloc returns memory aligned for any fundamental type
+    const std::size_t maxBlockSize = 4 * 1024 * 1024;
+    std::size_t blockSize = size > m_blockSize ? size : m_blockSize;
+    m_blockSize = m_blockSize * 2 > maxBlockSize ? maxBlockSize : m_blockSize * 2;
+    char* data = static_cast<char*>(std::malloc(blockSize));
+    if (data == nullptr) {
+        throw std::bad_alloc();
+    }
+    m_blocks.push_back(Block { data, blockSize });
+    m_current = m_blocks.size() - 1;
+    m_offset = size;
+    return data;
+}
+
+const char* JsonArena::CopyString(const char* str, std::size_t length)
+{
+    char* dest = static_cast<char*>(Allocate(length, 1));
+    if (length != 0) {
+        std::memcpy(dest, str, length);
+    }
+    return dest;
+}
+
+void JsonArena::Reset()
+{
+    m_current = 0;
+    m_offset = 0;
+}
+
+std::size_t JsonArena::Capacity() const
+{
+    std::size_t capacity = 0;
+    for (const Block& block: m_blocks) {
+        capacity += block.size;
+    }
+    return capacity;
+}
+
+const char JsonKeyPool::EMPTY_KEY[1] = "";
+
+JsonKeyPool::JsonKeyPool(JsonArena& arena): m_arena(arena)
+{}
+
+const char* JsonKeyPool::Intern(const char* key, std::size_t length)
+{
+    if (length == 0) {
+        m_hasEmptyKey = true;
+        return EMPTY_KEY;
+    }
+    if ((m_size + 1) * 2 > m_entries.size()) {
+        Grow();
+    }
+    Entry& entry = m_entries[Probe(key, length)];
+    if (entry.key == nullptr) {
+        entry.key = m_arena.CopyString(key, length);
+        entry.length = length;
+        m_size++;
+    }
+    return entry.key;
+}
+
+const char* JsonKeyPool::Find(const char* key, std::size_t length) const
+{
+    if (length == 0) {
+        return m_hasEmptyKey ? EMPTY_KEY : nullptr;
+    }
+    if (m_entries.empty()) {
+        return nullptr;
+    }
+    return m_entries[Probe(key, length)].key;
+}
+
+void JsonKeyPool::Clear()
+{
+    m_entries.clear();
+    m_size = 0;
+    m_hasEmptyKey = false;
+}
+
+std::size_t JsonKeyPool::Probe(const char* key, std::size_t length) const
+{
+    std::size_t mask = m_entries.size() - 1;
+    std::size_t slot = HashKey(key, length) & mask;
+    while (m_entries[slot].key != nullptr) {
+        const Entry& entry = m_entries[slot];
+        if (entry.length == length && std::memcmp(entry.key, key, length) == 0) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+void JsonKeyPool::Grow()
+{
+    std::vector<Entry> entries(m_entries.empty() ? 64 : m_entries.size() * 2, Entry { nullptr, 0 });
+    entries.swap(m_entries);
+    for (const Entry& entry: entries) {
+        if (entry.key != nullptr) {
+            m_entries[Probe(entry.key, entry.length)] = entry;
+        }
+    }
+}
+
+JsonDocumentBuilder::JsonDocumentBuilder(JsonScanner& scanner, JsonArena& arena, JsonKeyPool* keys)
+    : m_scanner(scanner), m_arena(arena), m_keys(keys)
+{}
+
+void JsonDocumentBuilder::Build(JsonNode& root)
+{
+    m_scanner.Reset();
+    m_depth = 0;
+    ParseNext(root);
+    if (m_scanner.Next() != JsonScanner::Token::EOF_TOKEN) {
+        Panic("json scanner reached non-eof token, position = %lu", m_scanner.Position());
+    }
+}
+
+void JsonDocumentBuilder::ParseNext(JsonNode& node)
+{
+    JsonScanner::Token token = m_scanner.Next();
+    switch (token) {
+        case JsonScanner::Token::OBJECT_BEGIN: {
+            EnterContainer();
+            ParseJsonObject(node);
+            m_depth--;
+            return;
+        }
+        case JsonScanner::Token::ARRAY_BEGIN: {
+            EnterContainer();
+            ParseJsonArray(node);
+            m_depth--;
+            return;
+        }
+        case JsonScanner::Token::STRING: {
+            const std::string& str = m_scanner.GetStringValue();
+            node.m_type = JsonElement::Type::JSON_STRING;
+            node.m_value.stringValue = m_arena.CopyString(str.data(), str.size());
+            node.m_size = str.size();
+            return;
+        }
+        case JsonScanner::Token::NUMBER: {
+            if (m_scanner.IsNumberLongInt()) {
+                node.m_type = JsonElement::Type::JSON_NUMBER_LONG;
+                node.m_value.numberLongValue = m_scanner.GetLongIntValue();
+            } else {
+                node.m_type = JsonElement::Type::JSON_NUMBER_DOUBLE;
+                node.m_value.numberDoubleValue = m_scanner.GetDoubleValue();
+            }
+            return;
+        }
+        case JsonScanner::Token::LITERAL_TRUE:
+        case JsonScanner::Token::LITERAL_FALSE: {
+            node.m_type = JsonElement::Type::JSON_BOOL;
+            node.m_value.boolValue = (token == JsonScanner::Token::LITERAL_TRUE);
+            return;
+        }
+        case JsonScanner::Token::LITERAL_NULL: {
+            node.m_type = JsonElement::Type::JSON_NULL;
+            return;
+        }
+        case JsonScanner::Token::WHITESPACE:
+        case JsonScanner::Token::COMMA:
+        case JsonScanner::Token::COLON:
+        case JsonScanner::Token::ARRAY_END:
+        case JsonScanner::Token::OBJECT_END:
+        case JsonScanner::Token::EOF_TOKEN:
+        default : Panic("scanner return unexpected token: %s", JsonScanner::TokenName(token).c_str());
+    }
+}
+
+void JsonDocumentBuilder::EnterContainer()
+{
+    if (m_depth >= JsonParser::MAX_DEPTH) {
+        Panic("json nesting exceeds %lu levels, position: %lu", JsonParser::MAX_DEPTH, m_scanner.Position());
+    }
+    m_depth++;
+}
+
+void JsonDocumentBuilder::ParseJsonObject(JsonNode& node)
+{
+    std::size_t base = m_memberStack.size();
+    JsonScanner::Token token = m_scanner.Next();
+    if (token != JsonScanner::Token::OBJECT_END) {
+        m_scanner.RollBack();
+        while (true) {
+            size_t pos = m_scanner.Position();
+            token = m_scanner.Next();
+            if (token != JsonScanner::Token::STRING) {
+                Panic("expect a string as key for json object, position: %lu", pos);
+            }
+            JsonMember member {};
+            const std::string& key = m_scanner.GetStringValue();
+            member.key = m_keys != nullptr ?
+                m_keys->Intern(key.data(), key.size()) : m_arena.CopyString(key.data(), key.size());
+            member.keyLength = key.size();
+
+            pos = m_scanner.Position();
+            token = m_scanner.Next();
+            if (token != JsonScanner::Token::COLON) {
+                Panic("expect ':' in json object, position: %lu", pos);
+            }
+            ParseNext(member.value);
+            m_memberStack.push_back(member);
+
+            pos = m_scanner.Position();
+            token = m_scanner.Next();
+            if (token == JsonScanner::Token::OBJECT_END) {
+                break;
+            }
+            if (token != JsonScanner::Token::COMMA) {
+                Panic("expect ',' in json object, position: %lu", pos);
+            }
+        }
+    }
+    std::size_t count = m_memberStack.size() - base;
+    JsonMember* members = static_cast<JsonMember*>(m_arena.Allocate(count * sizeof(JsonMember), alignof(JsonMember)));
+    std::uninitialized_copy(m_memberStack.begin() + base, m_memberStack.end(), members);
+    m_memberStack.resize(base);
+    node.m_type = JsonElement::Type::JSON_OBJECT;
+    node.m_value.members = members;
+    node.m_size = count;
+}
+
+void JsonDocumentBuilder::ParseJsonArray(JsonNode& node)
+{
+    std::size_t base = m_elementStack.size();
+    JsonScanner::Token token = m_scanner.Next();
+    if (token != JsonScanner::Token::ARRAY_END) {
+        m_scanner.RollBack();
+        while (true) {
+            JsonNode element {};
+            ParseNext(element);
+            m_elementStack.push_back(element);
+            size_t pos = m_scanner.Position();
+            token = m_scanner.Next();
+            if (token == JsonScanner::Token::ARRAY_END) {
+                break;
+            }
+            if (token != JsonScanner::Token::COMMA) {
+                Panic("expect ',' in array, pos: %lu", pos);
+            }
+        }
+    }
+    std::size_t count = m_elementStack.size() - base;
+    JsonNode* elements = static_cast<JsonNode*>(m_arena.Allocate(count * sizeof(JsonNode), alignof(JsonNode)));
+    std::uninitialized_copy(m_elementStack.begin() + base, m_elementStack.end(), elements);
+    m_elementStack.resize(base);
+    node.m_type = JsonElement::Type::JSON_ARRAY;
+    node.m_value.elements = elements;
+    node.m_size = count;
+}
+
+JsonNode::JsonNode()
+{}
+
+bool JsonNode::IsNull() const { return m_type == JsonElement::Type::JSON_NULL; }
+bool JsonNode::IsBool() const { return m_type == JsonElement::Type::JSON_BOOL; }
+bool JsonNode::IsDouble() const { return m_type == JsonElement::Type::JSON_NUMBER_DOUBLE; }
+bool JsonNode::IsLongInt() const { return m_type == JsonElement::Type::JSON_NUMBER_LONG; }
+bool JsonNode::IsString() const { return m_type == JsonElement::Type::JSON_STRING; }
+bool JsonNode::IsJsonObject() const { return m_type == JsonElement::Type::JSON_OBJECT; }
+bool JsonNode::IsJsonArray() const { return m_type == JsonElement::Type::JSON_ARRAY; }
+
+bool JsonNode::ToBool() const
+{
+    if (m_type != JsonElement::Type::JSON_BOOL) {
+        Panic("failed to convert json node %s as a bool", TypeName().c_str());
+    }
+    return m_value.boolValue;
+}
+
+double JsonNode::ToDouble() const
+{
+    if (m_type == JsonElement::Type::JSON_NUMBER_LONG) {
+        return static_cast<double>(m_value.numberLongValue);
+    }
+    if (m_type != JsonElement::Type::JSON_NUMBER_DOUBLE) {
+        Panic("failed to convert json node %s as a double", TypeName().c_str());
+    }
+    return m_value.numberDoubleValue;
+}
+
+int64_t JsonNode::ToLongInt() const
+{
+    if (m_type == JsonElement::Type::JSON_NUMBER_DOUBLE) {
+        return util::DoubleToLongInt(m_value.numberDoubleValue);
+    }
+    if (m_type != JsonElement::Type::JSON_NUMBER_LONG) {
+        Panic("failed to convert json node %s as a long int", TypeName().c_str());
+    }
+    return m_value.numberLongValue;
+}
+
+std::string JsonNode::ToString() const
+{
+    return std::string(StringData(), m_size);
+}
+
+const char* JsonNode::StringData() const
+{
+    if (m_type != JsonElement::Type::JSON_STRING) {
+        Panic("failed to convert json node %s as a string", TypeName().c_str());
+    }
+    return m_value.stringValue;
+}
+
+std::size_t JsonNode::StringLength() const
+{
+    if (m_type != JsonElement::Type::JSON_STRING) {
+        Panic("failed to convert json node %s as a string", TypeName().c_str());
+    }
+    return m_size;
+}
+
+JsonElement JsonNode::ToJsonElement() const
+{
+    switch (m_type) {
+        case JsonElement::Type::JSON_OBJECT: {
+            JsonObject object {};
+            for (std::size_t i = 0; i < m_size; ++i) {
+                object[m_value.members[i].Key()] = m_value.members[i].value.ToJsonElement();
+            }
+            return JsonElement(std::move(object));
+        }
+        case JsonElement::Type::JSON_ARRAY: {
+            JsonArray array {};
+            array.reserve(m_size);
+            for (std::size_t i = 0; i < m_size; ++i) {
+                array.push_back(m_value.elements[i].ToJsonElement());
+            }
+            return JsonElement(std::move(array));
+        }
+        case JsonElement::Type::JSON_STRING: {
+            return JsonElement(ToString());
+        }
+        case JsonElement::Type::JSON_NUMBER_LONG: {
+            return JsonElement(m_value.numberLongValue);
+        }
+        case JsonElement::Type::JSON_NUMBER_DOUBLE: {
+            return JsonElement(m_value.numberDoubleValue);
+        }
+        case JsonElement::Type::JSON_BOOL: {
+            return JsonElement(m_value.boolValue);
+        }
+        case JsonElement::Type::JSON_NULL: {
+            break;
+        }
+    }
+    return JsonElement();
+}
+
+std::size_t JsonNode::Size() const
+{
+    if (m_type != JsonElement::Type::JSON_ARRAY && m_type != JsonElement::Type::JSON_OBJECT) {
+        Panic("json node %s has no size", TypeName().c_str());
+    }
+    return m_size;
+}
+
+const JsonNode& JsonNode::operator [] (std::size_t index) const
+{
+    if (m_type != JsonElement::Type::JSON_ARRAY) {
+        Panic("failed to convert json node %s as an array", TypeName().c_str());
+    }
+    if (index >= m_size) {
+        Panic("array index %lu out of range, size: %lu", index, m_size);
+    }
+    return m_value.elements[index];
+}
+
+const JsonMember& JsonNode::MemberAt(std::size_t index) const
+{
+    if (m_type != JsonElement::Type::JSON_OBJECT) {
+        Panic("failed to convert json node %s as an object", TypeName().c_str());
+    }
+    if (index >= m_size) {
+        Panic("member index %lu out of range, size: %lu", index, m_size);
+    }
+    return m_value.members[index];
+}
+
+const JsonNode* JsonNode::Find(const std::string& key) const
+{
+    if (m_type != JsonElement::Type::JSON_OBJECT) {
+        Panic("failed to convert json node %s as an object", TypeName().c_str());
+    }
+    // search backward so that the last duplicated key wins, same as JsonParser
+    for (std::size_t i = m_size; i > 0; --i) {
+        const JsonMember& member = m_value.members[i - 1];
+        if (member.keyLength == key.size() && std::memcmp(member.key, key.data(), key.size()) == 0) {
+            return &member.value;
+        }
+    }
+    return nullptr;
+}
+
+const JsonNode* JsonNode::FindInterned(const char* key) const
+{
+    if (m_type != JsonElement::Type::JSON_OBJECT) {
+        Panic("failed to convert json node %s as an object", TypeName().c_str());
+    }
+    for (std::size_t i = m_size; i > 0; --i) {
+        const JsonMember& member = m_value.members[i - 1];
+        if (member.key == key) {
+            return &member.value;
+        }
+    }
+    return nullptr;
+}
+
+const JsonNode& JsonNode::operator [] (const std::string& key) const
+{
+    const JsonNode* node = Find(key);
+    if (node == nullptr) {
+        Panic("json object has no key %.256s", key.c_str());
+    }
+    return *node;
+}
+
+JsonElement::Type JsonNode::GetType() const { return m_type; }
+
+std::string JsonNode::TypeName() const
+{
+    return JsonElement(m_type).TypeName();
+}
+
+namespace {
+    // the whole range must spell the literal, a matching first char is not enough
+    bool LazyLiteralEquals(const char* begin, const char* end, const char* literal, std::size_t length)
+    {
+        return static_cast<std::size_t>(end - begin) == length && std::memcmp(begin, literal, length) == 0;
+    }
+
+    // raw text of a key without quotes, compared without decoding unless it has escapes
+    bool LazyKeyEquals(const char* keyBegin, const char* keyEnd, const std::string& key)
+    {
+        std::size_t rawLength = static_cast<std::size_t>(keyEnd - keyBegin);
+        if (std::memchr(keyBegin, '\\', rawLength) == nullptr) {
+            return rawLength == key.size() && std::memcmp(keyBegin, key.data(), rawLength) == 0;
+        }
+        JsonScanner scanner(keyBegin - 1, rawLength + 2);
+        scanner.Next();
+        return scanner.GetStringValue() == key;
+    }
+
+    /**
+     * walk the members of the object text [begin, end) skipping every value,
+     * visit(keyBegin, keyEnd, valueBegin, valueEnd) returns true to stop, return whether the walk was stopped
+     */
+    template<typename Visitor>
+    bool ForEachLazyMember(const char* begin, const char* end, Visitor visit)
+    {
+        std::size_t length = static_cast<std::size_t>(end - begin);
+        std::size_t pos = util::SkipWhitespace(begin, 1, length);
+        if (pos < length && begin[pos] == '}') {
+            return false;
+        }
+        while (true) {
+            if (pos >= length || begin[pos] != '\"') {
+                Panic("expect a string as key for json object, position: %lu", pos);
+            }
+            std::size_t keyEnd = util::SkipValue(begin, pos, length);
+            std::size_t colon = util::SkipWhitespace(begin, keyEnd, length);
+            if (colon >= length || begin[colon] != ':') {
+                Panic("expect ':' in json object, position: %lu", colon);
+            }
+            std::size_t valueBegin = util::SkipWhitespace(begin, colon + 1, length);
+            std::size_t valueEnd = util::SkipValue(begin, valueBegin, length);
+            if (visit(begin + pos + 1, begin + keyEnd - 1, begin + valueBegin, begin + valueEnd)) {
+                return true;
+            }
+            pos = util::SkipWhitespace(begin, valueEnd, length);
+            if (pos < length && begin[pos] == '}') {
+                return false;
+            }
+            if (pos >= length || begin[pos] != ',') {
+                Panic("expect ',' in json object, position: %lu", pos);
+            }
+            pos = util::SkipWhitespace(begin, pos + 1, length);
+        }
+    }
+
+    // same as ForEachLazyMember for the elements of the array text [begin, end), visit(valueBegin, valueEnd)
+    template<typename Visitor>
+    bool ForEachLazyElement(const char* begin, const char* end, Visitor visit)
+    {
+        std::size_t length = static_cast<std::size_t>(end - begin);
+        std::size_t pos = util::SkipWhitespace(begin, 1, length);
+        if (pos < length && begin[pos] == ']') {
+            return false;
+        }
+        while (true) {
+            std::size_t valueEnd = util::SkipValue(begin, pos, length);
+            if (visit(begin + pos, begin + valueEnd)) {
+                return true;
+            }
+            pos = util::SkipWhitespace(begin, valueEnd, length);
+            if (pos < length && begin[pos] == ']') {
+                return false;
+            }
+            if (pos >= length || begin[pos] != ',') {
+                Panic("expect ',' in array, pos: %lu", pos);
+            }
+            pos = util::SkipWhitespace(begin, pos + 1, length);
+        }
+    }
+}
+
+JsonLazyElement::JsonLazyElement() : m_begin("null"), m_end(m_begin + 4)
+{}
+
+JsonLazyElement::JsonLazyElement(const char* data, std::size_t length)
+{
+    std::size_t begin = util::SkipWhitespace(data, 0, length);
+    std::size_t end = length;
+    while (end > begin && (data[end - 1] == ' ' || data[end - 1] == '\n' || data[end - 1] == '\r'
+        || data[end - 1] == '\t')) {
+        end--;
+    }
+    if (begin == end) {
+        Panic("empty json input");
+    }
+    m_begin = data + begin;
+    m_end = data + end;
+}
+
+JsonLazyElement::JsonLazyElement(const std::string& str) : JsonLazyElement(str.data(), str.size())
+{}
+
+JsonLazyElement JsonLazyElement::FromRange(const char* begin, const char* end)
+{
+    JsonLazyElement element;
+    element.m_begin = begin;
+    element.m_end = end;
+    return element;
+}
+
+bool JsonLazyElement::IsNull() const { return GetType() == JsonElement::Type::JSON_NULL; }
+bool JsonLazyElement::IsBool() const { return GetType() == JsonElement::Type::JSON_BOOL; }
+bool JsonLazyElement::IsLongInt() const { return GetType() == JsonElement::Type::JSON_NUMBER_LONG; }
+bool JsonLazyElement::IsDouble() const { return GetType() == JsonElement::Type::JSON_NUMBER_DOUBLE; }
+bool JsonLazyElement::IsString() const { return GetType() == JsonElement::Type::JSON_STRING; }
+bool JsonLazyElement::IsJsonObject() const { return GetType() == JsonElement::Type::JSON_OBJECT; }
+bool JsonLazyElement::IsJsonArray() const { return GetType() == JsonElement::Type::JSON_ARRAY; }
+
+bool JsonLazyElement::ToBool() const
+{
+    if (GetType() != JsonElement::Type::JSON_BOOL) {
+        Panic("failed to convert json lazy element %s as a bool", TypeName().c_str());
+    }
+    // GetType() already matched the whole literal
+    return *m_begin == 't';
+}
+
+double JsonLazyElement::ToDouble() const
+{
+    JsonElement element = Materialize();
+    if (element.IsLongInt()) {
+        return static_cast<double>(element.AsLongInt());
+    }
+    if (!element.IsDouble()) {
+        Panic("failed to convert json lazy element %s as a double", TypeName().c_str());
+    }
+    return element.AsDouble();
+}
+
+int64_t JsonLazyElement::ToLongInt() const
+{
+    JsonElement element = Materialize();
+    if (element.IsDouble()) {
+        return util::DoubleToLongInt(element.AsDouble());
+    }
+    if (!element.IsLongInt()) {
+        Panic("failed to convert json lazy element %s as a long int", TypeName().c_str());
+    }
+    return element.AsLongInt();
+}
+
+std::string JsonLazyElement::ToString() const
+{
+    if (*m_begin != '\"') {
+        Panic("failed to convert json lazy element %s as a string", TypeName().c_str());
+    }
+    JsonScanner scanner(m_begin, Length());
+    scanner.Next();
+    return scanner.GetStringValue();
+}
+
+JsonElement JsonLazyElement::Materialize() const
+{
+    return JsonParser(m_begin, Length()).Parse();
+}
+
+std::size_t JsonLazyElement::Size() const
+{
+    std::size_t count = 0;
+    if (*m_begin == '{') {
+        ForEachLazyMember(m_begin, m_end, [&](const char*, const char*, const char*, const char*) {
+            count++;
+            return false;
+        });
+        return count;
+    }
+    CheckContainer('[');
+    ForEachLazyElement(m_begin, m_end, [&](const char*, const char*) {
+        count++;
+        return false;
+    });
+    return count;
+}
+
+JsonLazyElement JsonLazyElement::operator [] (std::size_t index) const
+{
+    CheckContainer('[');
+    JsonLazyElement element;
+    std::size_t current = 0;
+    bool found = ForEachLazyElement(m_begin, m_end, [&](const char* begin, const char* end) {
+        if (current++ != index) {
+            return false;
+        }
+        element = FromRange(begin, end);
+        return true;
+    });
+    if (!found) {
+        Panic("json array index %lu out of range", index);
+    }
+    return element;
+}
+
+bool JsonLazyElement::Find(const std::string& key, JsonLazyElement& element) const
+{
+    CheckContainer('{');
+    return ForEachLazyMember(m_begin, m_end,
+        [&](const char* keyBegin, const char* keyEnd, const char* valueBegin, const char* valueEnd) {
+            if (!LazyKeyEquals(keyBegin, keyEnd, key)) {
+                return false;
+            }
+            element = FromRange(valueBegin, valueEnd);
+            return true;
+        });
+}
+
+JsonLazyElement JsonLazyElement::operator [] (const std::string& key) const
+{
+    JsonLazyElement element;
+    if (!Find(key, element)) {
+        Panic("json object has no key %.256s", key.c_str());
+    }
+    return element;
+}
+
+const char* JsonLazyElement::Data() const
+{
+    return m_begin;
+}
+
+std::size_t JsonLazyElement::Length() const
+{
+    return static_cast<std::size_t>(m_end - m_begin);
+}
+
+JsonElement::Type JsonLazyElement::GetType() const
+{
+    switch (*m_begin) {
+        case '{': return JsonElement::Type::JSON_OBJECT;
+        case '[': return JsonElement::Type::JSON_ARRAY;
+        case '\"': return JsonElement::Type::JSON_STRING;
+        case 't':
+            if (LazyLiteralEquals(m_begin, m_end, "true", 4)) {
+                return JsonElement::Type::JSON_BOOL;
+            }
+            break;
+        case 'f':
+            if (LazyLiteralEquals(m_begin, m_end, "false", 5)) {
+                return JsonElement::Type::JSON_BOOL;
+            }
+            break;
+        case 'n':
+            if (LazyLiteralEquals(m_begin, m_end, "null", 4)) {
+                return JsonElement::Type::JSON_NULL;
+            }
+            break;
+        default: break;
+    }
+    std::size_t pos = 0;
+    bool isLongInt = false;
+    int64_t longValue = 0;
+    double doubleValue = 0;
+    if (!util::ScanNumber(m_begin, Length(), pos, isLongInt, longValue, doubleValue) || pos != Length()) {
+        Panic("Invalid token: %.*s", static_cast<int>(Length() < 32 ? Length() : 32), m_begin);
+    }
+    return isLongInt ? JsonElement::Type::JSON_NUMBER_LONG : JsonElement::Type::JSON_NUMBER_DOUBLE;
+}
+
+std::string JsonLazyElement::TypeName() const
+{
+    return JsonElement(GetType()).TypeName();
+}
+
+void JsonLazyElement::CheckContainer(char open) const
+{
+    if (*m_begin != open) {
+        Panic("json lazy element %s is not a %s", TypeName().c_str(), open == '{' ? "object" : "array");
+    }
+}
+
+namespace {
+    const std::size_t NO_INDEX = static_cast<std::size_t>(-1);
+
+    // "0" or digits without a leading zero as RFC 6901 requires, NO_INDEX otherwise
+    std::size_t ParsePointerIndex(const std::string& token)
+    {
+        if (token.empty() || token.size() > 18 || (token.size() > 1 && token[0] == '0')) {
+            return NO_INDEX;
+        }
+        std::size_t index = 0;
+        for (char ch: token) {
+            if (ch < '0' || ch > '9') {
+                return NO_INDEX;
+            }
+            index = index * 10 + static_cast<std::size_t>(ch - '0');
+        }
+        return index;
+    }
+}
+
+JsonPath JsonPath::Pointer(const std::string& pointer)
+{
+    return JsonPath(pointer, false);
+}
+
+JsonPath JsonPath::Compile(const std::string& path)
+{
+    return JsonPath(path, true);
+}
+
+JsonPath::JsonPath(const std::string& expression, bool extended)
+{
+    if (!expression.empty() && expression[0] != '/') {
+        Panic("json pointer must start with '/': %.256s", expression.c_str());
+    }
+    std::size_t pos = 0;
+    while (pos < expression.size()) {
+        std::size_t next = expression.find('/', pos + 1);
+        std::string raw = expression.substr(pos + 1, next == std::string::npos ? std::string::npos : next - pos - 1);
+        pos = next == std::string::npos ? expression.size() : next;
+
+        Segment segment { SegmentType::KEY, std::string(), NO_INDEX, NO_INDEX };
+        std::size_t colon = raw.find(':');
+        if (extended && raw == "*") {
+            segment.type = SegmentType::WILDCARD;
+        } else if (extended && colon != std::string::npos) {
+            std::string first = raw.substr(0, colon);
+            std::string last = raw.substr(colon + 1);
+            segment.type = SegmentType::RANGE;
+            segment.first = first.empty() ? 0 : ParsePointerIndex(first);
+            segment.last = last.empty() ? NO_INDEX : ParsePointerIndex(last);
+            if (segment.first == NO_INDEX || (!last.empty() && segment.last == NO_INDEX)) {
+                Panic("invalid index range in json path: %.256s", raw.c_str());
+            }
+        } else {
+            // ~1 is '/' and ~0 is '~', Compile() also takes ~2 for '*' and ~3 for ':'
+            const char* unescaped = extended ? "~/*:" : "~/";
+            char maxEscape = extended ? '3' : '1';
+            for (std::size_t i = 0; i < raw.size(); ++i) {
+                if (raw[i] != '~') {
+                    segment.key.push_back(raw[i]);
+                    continue;
+                }
+                if (i + 1 >= raw.size() || raw[i + 1] < '0' || raw[i + 1] > maxEscape) {
+                    Panic("invalid escape in json pointer: %.256s", raw.c_str());
+                }
+                segment.key.push_back(unescaped[raw[++i] - '0']);
+            }
+            segment.first = ParsePointerIndex(segment.key);
+        }
+        m_segments.push_back(std::move(segment));
+    }
+}
+
+std::vector<JsonElement> JsonPath::Evaluate(const char* data, std::size_t length) const
+{
+    std::vector<JsonElement> results;
+    JsonLazyElement root(data, length);
+    Evaluate(0, root.Data(), root.Data() + root.Length(), results);
+    return results;
+}
+
+std::vector<JsonElement> JsonPath::Evaluate(const std::string& str) const
+{
+    return Evaluate(str.data(), str.size());
+}
+
+void JsonPath::Evaluate(std::size_t segmentIndex, const char* begin, const char* end,
+    std::vector<JsonElement>& results) const
+{
+    if (segmentIndex == m_segments.size()) {
+        results.push_back(JsonParser(begin, static_cast<std::size_t>(end - begin)).Parse());
+        return;
+    }
+    const Segment& segment = m_segments[segmentIndex];
+    if (*begin == '{') {
+        if (segment.type == SegmentType::RANGE) {
+            return;
+        }
+        ForEachLazyMember(begin, end,
+            [&](const char* keyBegin, const char* keyEnd, const char* valueBegin, const char* valueEnd) {
+                if (segment.type == SegmentType::WILDCARD) {
+                    Evaluate(segmentIndex + 1, valueBegin, valueEnd, results);
+                    return false;
+                }
+                if (!LazyKeyEquals(keyBegin, keyEnd, segment.key)) {
+                    return false;
+                }
+                Evaluate(segmentIndex + 1, valueBegin, valueEnd, results);
+                return true;
+            });
+        return;
+    }
+    if (*begin == '[') {
+        if (segment.type == SegmentType::KEY && segment.first == NO_INDEX) {
+            return;
+        }
+        std::size_t first = segment.type == SegmentType::WILDCARD ? 0 : segment.first;
+        std::size_t last = segment.type == SegmentType::KEY ? segment.first + 1 : segment.last;
+        std::size_t index = 0;
+        ForEachLazyElement(begin, end, [&](const char* valueBegin, const char* valueEnd) {
+            if (index >= first && (last == NO_INDEX || index < last)) {
+                Evaluate(segmentIndex + 1, valueBegin, valueEnd, results);
+            }
+            index++;
+            // elements after the selected ones are not visited
+            return last != NO_INDEX && index >= last;
+        });
+    }
+}
+
+JsonDocument::JsonDocument(): m_arena(new JsonArena())
+{}
+
+JsonDocument::~JsonDocument()
+{
+    if (m_keys != nullptr) {
+        delete m_keys;
+        m_keys = nullptr;
+    }
+    if (m_arena != nullptr) {
+        delete m_arena;
+        m_arena = nullptr;
+    }
+}
+
+const JsonNode& JsonDocument::Parse(const char* data, std::size_t length)
+{
+    Clear();
+    JsonScanner scanner(data, length);
+    JsonDocumentBuilder builder(scanner, *m_arena, m_keys);
+    JsonNode root {};
+    builder.Build(root);
+    m_root = root;
+    return m_root;
+}
+
+const JsonNode& JsonDocument::Parse(const std::string& str)
+{
+    return Parse(str.data(), str.size());
+}
+
+const JsonNode& JsonDocument::Root() const { return m_root; }
+
+void JsonDocument::Clear()
+{
+    m_root = JsonNode();
+    m_arena->Reset();
+    if (m_keys != nullptr) {
+        m_keys->Clear();
+    }
+}
+
+std::size_t JsonDocument::Capacity() const { return m_arena->Capacity(); }
+
+void JsonDocument::InternKeys(bool enabled)
+{
+    if (enabled && m_keys == nullptr) {
+        m_keys = new JsonKeyPool(*m_arena);
+    } else if (!enabled && m_keys != nullptr) {
+        delete m_keys;
+        m_keys = nullptr;
+    }
+}
+
+const char* JsonDocument::InternedKey(const std::string& key) const
+{
+    return m_keys == nullptr ? nullptr : m_keys->Find(key.data(), key.size());
+}
+
+namespace {
+    const uint64_t TAPE_PAYLOAD_MASK = (static_cast<uint64_t>(1) << 56) - 1;
+    const uint64_t TAPE_INDEX_MASK = 0xFFFFFFFFULL;
+    const uint64_t TAPE_COUNT_MAX = 0xFFFFFFULL;
+
+    inline uint64_t TapeEntry(char tag, uint64_t payload)
+    {
+        return (static_cast<uint64_t>(static_cast<unsigned char>(tag)) << 56) | (payload & TAPE_PAYLOAD_MASK);
+    }
+}
+
+JsonTapeRef JsonTape::Parse(const char* data, std::size_t length)
+{
+    m_tape.clear();
+    m_strings.clear();
+    m_depth = 0;
+    JsonScanner scanner(data, length);
+    try {
+        ParseNext(scanner);
+        if (scanner.Next() != JsonScanner::Token::EOF_TOKEN) {
+            Panic("json scanner reached non-eof token, position = %lu", scanner.Position());
+        }
+    } catch (...) {
+        m_tape.clear();
+        m_strings.clear();
+        throw;
+    }
+    return Root();
+}
+
+JsonTapeRef JsonTape::Parse(const std::string& str)
+{
+    return Parse(str.data(), str.size());
+}
+
+JsonTapeRef JsonTape::Root() const
+{
+    if (m_tape.empty()) {
+        Panic("json tape is empty");
+    }
+    return JsonTapeRef(this, 0);
+}
+
+void JsonTape::ParseNext(JsonScanner& scanner)
+{
+    JsonScanner::Token token = scanner.Next();
+    switch (token) {
+        case JsonScanner::Token::OBJECT_BEGIN: {
+            EnterContainer(scanner);
+            ParseJsonObject(scanner);
+            m_depth--;
+            return;
+        }
+        case JsonScanner::Token::ARRAY_BEGIN: {
+            EnterContainer(scanner);
+            ParseJsonArray(scanner);
+            m_depth--;
+            return;
+        }
+        case JsonScanner::Token::STRING: {
+            AppendString(scanner.GetStringValue());
+            return;
+        }
+        case JsonScanner::Token::NUMBER: {
+            uint64_t bits = 0;
+            if (scanner.IsNumberLongInt()) {
+                int64_t value = scanner.GetLongIntValue();
+                std::memcpy(&bits, &value, sizeof(bits));
+                m_tape.push_back(TapeEntry('l', 0));
+            } else {
+                double value = scanner.GetDoubleValue();
+                std::memcpy(&bits, &value, sizeof(bits));
+                m_tape.push_back(TapeEntry('d', 0));
+            }
+            m_tape.push_back(bits);
+            return;
+        }
+        case JsonScanner::Token::LITERAL_TRUE: {
+            m_tape.push_back(TapeEntry('t', 0));
+            return;
+        }
+        case JsonScanner::Token::LITERAL_FALSE: {
+            m_tape.push_back(TapeEntry('f', 0));
+            return;
+        }
+        case JsonScanner::Token::LITERAL_NULL: {
+            m_tape.push_back(TapeEntry('n', 0));
+            return;
+        }
+        case JsonScanner::Token::WHITESPACE:
+        case JsonScanner::Token::COMMA:
+        case JsonScanner::Token::COLON:
+        case JsonScanner::Token::ARRAY_END:
+        case JsonScanner::Token::OBJECT_END:
+        case JsonScanner::Token::EOF_TOKEN:
+        default : Panic("scanner return unexpected token: %s", JsonScanner::TokenName(token).c_str());
+    }
+}
+
+void JsonTape::EnterContainer(JsonScanner& scanner)
+{
+    if (m_depth >= JsonParser::MAX_DEPTH) {
+        Panic("json nesting exceeds %lu levels, position: %lu", JsonParser::MAX_DEPTH, scanner.Position());
+    }
+    m_depth++;
+}
+
+void JsonTape::ParseJsonObject(JsonScanner& scanner)
+{
+    std::size_t openIndex = m_tape.size();
+    std::size_t count = 0;
+    m_tape.push_back(TapeEntry('{', 0));
+    JsonScanner::Token token = scanner.Next();
+    if (token != JsonScanner::Token::OBJECT_END) {
+        scanner.RollBack();
+        while (true) {
+            size_t pos = scanner.Position();
+            token = scanner.Next();
+            if (token != JsonScanner::Token::STRING) {
+                Panic("expect a string as key for json object, position: %lu", pos);
+            }
+            AppendString(scanner.GetStringValue());
+
+            pos = scanner.Position();
+            token = scanner.Next();
+            if (token != JsonScanner::Token::COLON) {
+                Panic("expect ':' in json object, position: %lu", pos);
+            }
+            ParseNext(scanner);
+            count++;
+
+            pos = scanner.Position();
+            token = scanner.Next();
+            if (token == JsonScanner::Token::OBJECT_END) {
+                break;
+            }
+            if (token != JsonScanner::Token::COMMA) {
+                Panic("expect ',' in json object, position: %lu", pos);
+            }
+        }
+    }
+    CloseContainer(openIndex, '}', count);
+}
+
+void JsonTape::ParseJsonArray(JsonScanner& scanner)
+{
+    std::size_t openIndex = m_tape.size();
+    std::size_t count = 0;
+    m_tape.push_back(TapeEntry('[', 0));
+    JsonScanner::Token token = scanner.Next();
+    if (token != JsonScanner::Token::ARRAY_END) {
+        scanner.RollBack();
+        while (true) {
+            ParseNext(scanner);
+            count++;
+            size_t pos = scanner.Position();
+            token = scanner.Next();
+            if (token == JsonScanner::Token::ARRAY_END) {
+                break;
+            }
+            if (token != JsonScanner::Token::COMMA) {
+                Panic("expect ',' in array, pos: %lu", pos);
+            }
+        }
+    }
+    CloseContainer(openIndex, ']', count);
+}
+
+void JsonTape::AppendString(const std::string& str)
+{
+    m_tape.push_back(TapeEntry('"', m_strings.size()));
+    m_tape.push_back(str.size());
+    m_strings.append(str);
+}
+
+void JsonTape::CloseContainer(std::size_t openIndex, char closeTag, std::size_t count)
+{
+    std::size_t nextIndex = m_tape.size() + 1;
+    if (nextIndex > TAPE_INDEX_MASK) {
+        Panic("json value too large for tape, %lu entries", nextIndex);
+    }
+    char openTag = static_cast<char>(m_tape[openIndex] >> 56);
+    uint64_t savedCount = count < TAPE_COUNT_MAX ? count : TAPE_COUNT_MAX;
+    m_tape[openIndex] = TapeEntry(openTag, (savedCount << 32) | nextIndex);
+    m_tape.push_back(TapeEntry(closeTag, openIndex));
+}
+
+JsonTapeRef::JsonTapeRef(const JsonTape* tape, std::size_t index): m_tape(tape), m_index(index)
+{}
+
+uint64_t JsonTapeRef::Word(std::size_t offset) const { return m_tape->Tape()[m_index + offset]; }
+
+char JsonTapeRef::Tag() const { return static_cast<char>(Word() >> 56); }
+
+std::size_t JsonTapeRef::NextIndex() const
+{
+    switch (Tag()) {
+        case '{':
+        case '[':
+            return static_cast<std::size_t>(Word() & TAPE_INDEX_MASK);
+        case 'l':
+        case 'd':
+        case '"':
+            return m_index + 2;
+        default:
+            return m_index + 1;
+    }
+}
+
+void JsonTapeRef::CheckContainer(char tag) const
+{
+    if (Tag() != tag) {
+        Panic("failed to convert json tape entry %s as %s", TypeName().c_str(), tag == '{' ? "an object" : "an array");
+    }
+}
+
+bool JsonTapeRef::IsNull() const { return Tag() == 'n'; }
+bool JsonTapeRef::IsBool() const { return Tag() == 't' || Tag() == 'f'; }
+bool JsonTapeRef::IsLongInt() const { return Tag() == 'l'; }
+bool JsonTapeRef::IsDouble() const { return Tag() == 'd'; }
+bool JsonTapeRef::IsString() const { return Tag() == '"'; }
+bool JsonTapeRef::IsJsonObject() const { return Tag() == '{'; }
+bool JsonTapeRef::IsJsonArray() const { return Tag() == '['; }
+
+bool JsonTapeRef::ToBool() const
+{
+    if (!IsBool()) {
+        Panic("failed to convert json tape entry %s as a bool", TypeName().c_str());
+    }
+    return Tag() == 't';
+}
+
+double JsonTapeRef::ToDouble() const
+{
+    if (IsLongInt()) {
+        return static_cast<double>(ToLongInt());
+    }
+    if (!IsDouble()) {
+        Panic("failed to convert json tape entry %s as a double", TypeName().c_str());
+    }
+    uint64_t bits = Word(1);
+    double value = 0;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+int64_t JsonTapeRef::ToLongInt() const
+{
+    if (IsDouble()) {
+        return util::DoubleToLongInt(ToDouble());
+    }
+    if (!IsLongInt()) {
+        Panic("failed to convert json tape entry %s as a long int", TypeName().c_str());
+    }
+    uint64_t bits = Word(1);
+    int64_t value = 0;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+std::string JsonTapeRef::ToString() const
+{
+    return std::string(StringData(), StringLength());
+}
+
+const char* JsonTapeRef::StringData() const
+{
+    if (!IsString()) {
+        Panic("failed to convert json tape entry %s as a string", TypeName().c_str());
+    }
+    return m_tape->StringBuffer().data() + (Word() & TAPE_PAYLOAD_MASK);
+}
+
+std::size_t JsonTapeRef::StringLength() const
+{
+    if (!IsString()) {
+        Panic("failed to convert json tape entry %s as a string", TypeName().c_str());
+    }
+    return static_cast<std::size_t>(Word(1));
+}
+
+JsonElement JsonTapeRef::ToJsonElement() const
+{
+    switch (Tag()) {
+        case '{': {
+            JsonObject object {};
+            std::size_t index = m_index + 1;
+            while (JsonTapeRef(m_tape, index).Tag() != '}') {
+                JsonTapeRef key(m_tape, index);
+                JsonTapeRef value(m_tape, key.NextIndex());
+                object[key.ToString()] = value.ToJsonElement();
+                index = value.NextIndex();
+            }
+            return JsonElement(std::move(object));
+        }
+        case '[': {
+            JsonArray array {};
+            std::size_t index = m_index + 1;
+            while (JsonTapeRef(m_tape, index).Tag() != ']') {
+                JsonTapeRef element(m_tape, index);
+                array.push_back(element.ToJsonElement());
+                index = element.NextIndex();
+            }
+            return JsonElement(std::move(array));
+        }
+        case '"': return JsonElement(ToString());
+        case 'l': return JsonElement(ToLongInt());
+        case 'd': return JsonElement(ToDouble());
+        case 't': return JsonElement(true);
+        case 'f': return JsonElement(false);
+        default: break;
+    }
+    return JsonElement();
+}
+
+std::size_t JsonTapeRef::Size() const
+{
+    if (!IsJsonObject() && !IsJsonArray()) {
+        Panic("json tape entry %s has no size", TypeName().c_str());
+    }
+    std::size_t count = static_cast<std::size_t>((Word() >> 32) & TAPE_COUNT_MAX);
+    if (count < TAPE_COUNT_MAX) {
+        return count;
+    }
+    // saturated, count by skipping over the children
+    char closeTag = IsJsonObject() ? '}' : ']';
+    count = 0;
+    std::size_t index = m_index + 1;
+    while (JsonTapeRef(m_tape, index).Tag() != closeTag) {
+        index = JsonTapeRef(m_tape, index).NextIndex();
+        if (closeTag == '}') {
+            index = JsonTapeRef(m_tape, index).NextIndex();
+        }
+        count++;
+    }
+    return count;
+}
+
+JsonTapeRef JsonTapeRef::operator [] (std::size_t index) const
+{
+    CheckContainer('[');
+    JsonTapeRef element(m_tape, m_index + 1);
+    for (std::size_t i = 0; i < index && element.Tag() != ']'; ++i) {
+        element = JsonTapeRef(m_tape, element.NextIndex());
+    }
+    if (element.Tag() == ']') {
+        Panic("array index %lu out of range", index);
+    }
+    return element;
+}
+
+std::string JsonTapeRef::KeyAt(std::size_t index) const
+{
+    CheckContainer('{');
+    JsonTapeRef key(m_tape, m_index + 1);
+    for (std::size_t i = 0; i < index && key.Tag() != '}'; ++i) {
+        key = JsonTapeRef(m_tape, JsonTapeRef(m_tape, key.NextIndex()).NextIndex());
+    }
+    if (key.Tag() == '}') {
+        Panic("member index %lu out of range", index);
+    }
+    return key.ToString();
+}
+
+JsonTapeRef JsonTapeRef::ValueAt(std::size_t index) const
+{
+    CheckContainer('{');
+    JsonTapeRef key(m_tape, m_index + 1);
+    for (std::size_t i = 0; i < index && key.Tag() != '}'; ++i) {
+        key = JsonTapeRef(m_tape, JsonTapeRef(m_tape, key.NextIndex()).NextIndex());
+    }
+    if (key.Tag() == '}') {
+        Panic("member index %lu out of range", index);
+    }
+    return JsonTapeRef(m_tape, key.NextIndex());
+}
+
+bool JsonTapeRef::Find(const std::string& key, JsonTapeRef& value) const
+{
+    CheckContainer('{');
+    bool found = false;
+    JsonTapeRef member(m_tape, m_index + 1);
+    // walk all members so that the last duplicated key wins, same as JsonParser
+    while (member.Tag() != '}') {
+        JsonTapeRef memberValue(m_tape, member.NextIndex());
+        if (member.StringLength() == key.size() && std::memcmp(member.StringData(), key.data(), key.size()) == 0) {
+            value = memberValue;
+            found = true;
+        }
+        member = JsonTapeRef(m_tape, memberValue.NextIndex());
+    }
+    return found;
+}
+
+JsonTapeRef JsonTapeRef::operator [] (const std::string& key) const
+{
+    JsonTapeRef value(m_tape, m_index);
+    if (!Find(key, value)) {
+        Panic("json object has no key %.256s", key.c_str());
+    }
+    return value;
+}
+
+JsonElement::Type JsonTapeRef::GetType() const
+{
+    switch (Tag()) {
+        case '{': return JsonElement::Type::JSON_OBJECT;
+        case '[': return JsonElement::Type::JSON_ARRAY;
+        case '"': return JsonElement::Type::JSON_STRING;
+        case 'l': return JsonElement::Type::JSON_NUMBER_LONG;
+        case 'd': return JsonElement::Type::JSON_NUMBER_DOUBLE;
+        case 't':
+        case 'f': return JsonElement::Type::JSON_BOOL;
+        default: break;
+    }
+    return JsonElement::Type::JSON_NULL;
+}
+
+std::string JsonTapeRef::TypeName() const
+{
+    return JsonElement(GetType()).TypeName();
+}
+
+#ifdef _WIN32
+FileBuffer::FileBuffer(const std::string& path)
+{
+    HANDLE file = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        Panic("failed to open file %.256s, error: %lu", path.c_str(), ::GetLastError());
+    }
+    LARGE_INTEGER fileSize {};
+    if (::GetFileType(file) == FILE_TYPE_DISK && ::GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+        HANDLE mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping != nullptr) {
+            m_mapped = static_cast<const char*>(::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            m_mappedSize = static_cast<std::size_t>(fileSize.QuadPart);
+            ::CloseHandle(mapping);
+        }
+    }
+    if (m_mapped == nullptr) {
+        char chunk[64 * 1024];
+        DWORD bytesRead = 0;
+        while (::ReadFile(file, chunk, sizeof(chunk), &bytesRead, nullptr) && bytesRead > 0) {
+            m_buffer.append(chunk, bytesRead);
+        }
+    }
+    ::CloseHandle(file);
+}
+
+FileBuffer::~FileBuffer()
+{
+    if (m_mapped != nullptr) {
+        ::UnmapViewOfFile(m_mapped);
+        m_mapped = nullptr;
+    }
+}
+#else
+FileBuffer::FileBuffer(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        Panic("failed to open file %.256s, errno: %d", path.c_str(), errno);
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* addr = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+#ifdef MADV_SEQUENTIAL
+            ::madvise(addr, static_cast<std::size_t>(st.st_size), MADV_SEQUENTIAL);
+#endif
+            m_mapped = static_cast<const char*>(addr);
+            m_mappedSize = static_cast<std::size_t>(st.st_size);
+        }
+    }
+    if (m_mapped == nullptr) {
+        char chunk[64 * 1024];
+        ssize_t bytesRead = 0;
+        while ((bytesRead = ::read(fd, chunk, sizeof(chunk))) != 0) {
+            if (bytesRead < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                ::close(fd);
+                Panic("failed to read file %.256s, errno: %d", path.c_str(), errno);
+            }
+            m_buffer.append(chunk, static_cast<std::size_t>(bytesRead));
+        }
+    }
+    ::close(fd);
+}
+
+FileBuffer::~FileBuffer()
+{
+    if (m_mapped != nullptr) {
+        ::munmap(const_cast<char*>(m_mapped), m_mappedSize);
+        m_mapped = nullptr;
+    }
+}
+#endif
+
+namespace {
+    // bit i of each mask is set when byte i of a 64 bytes block is of the given class
+    struct BlockMasks {
+        uint64_t quote;
+        uint64_t backslash;
+        uint64_t whitespace;
+        uint64_t op; // { } [ ] : ,
+    };
+
+    using ClassifyBlockFunc = void (*)(const char* block, BlockMasks& masks);
+
+#ifndef MINIJSON_X86_SIMD
+    void ClassifyBlockScalar(const char* block, BlockMasks& masks)
+    {
+        masks = BlockMasks { 0, 0, 0, 0 };
+        for (int i = 0; i < 64; ++i) {
+            uint64_t bit = static_cast<uint64_t>(1) << i;
+            switch (block[i]) {
+                case '"': masks.quote |= bit; break;
+                case '\\': masks.backslash |= bit; break;
+                case ' ':
+                case '\n':
+                case '\r':
+                case '\t': masks.whitespace |= bit; break;
+                case '{':
+                case '}':
+                case '[':
+                case ']':
+                case ':':
+                case ',': masks.op |= bit; break;
+                default: break;
+            }
+        }
+    }
+#endif
+
+#ifdef MINIJSON_X86_SIMD
+    void ClassifyBlockSSE2(const char* block, BlockMasks& masks)
+    {
+        masks = BlockMasks { 0, 0, 0, 0 };
+        for (int i = 0; i < 4; ++i) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i * 16));
+            __m128i ws = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'))),
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t'))));
+            __m128i op = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('{')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('}'))),
+                _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('[')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8(']'))),
+                    _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(':')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8(',')))));
+            int shift = i * 16;
+            masks.quote |= static_cast<uint64_t>(static_cast<uint16_t>(
+                _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('"'))))) << shift;
+            masks.backslash |= static_cast<uint64_t>(static_cast<uint16_t>(
+                _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\'))))) << shift;
+            masks.whitespace |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(ws))) << shift;
+            masks.op |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(op))) << shift;
+        }
+    }
+
+#if defined(__GNUC__) || defined(__clang__)
+    __attribute__((target("avx2")))
+#endif
+    void ClassifyBlockAVX2(const char* block, BlockMasks& masks)
+    {
+        masks = BlockMasks { 0, 0, 0, 0 };
+        for (int i = 0; i < 2; ++i) {
+            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i * 32));
+            __m256i ws = _mm256_or_si256(
+                _mm256_or_si256(
+                    _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n'))),
+                _mm256_or_si256(
+                    _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\r')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\t'))));
+            __m256i op = _mm256_or_si256(
+                _mm256_or_si256(
+                    _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('}'))),
+                _mm256_or_si256(
+                    _mm256_or_si256(
+                        _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('[')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(']'))),
+                    _mm256_or_si256(
+                        _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(':')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(',')))));
+            int shift = i * 32;
+            masks.quote |= static_cast<uint64_t>(static_cast<uint32_t>(
+                _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"'))))) << shift;
+            masks.backslash |= static_cast<uint64_t>(static_cast<uint32_t>(
+                _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\'))))) << shift;
+            masks.whitespace |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(ws))) << shift;
+            masks.op |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(op))) << shift;
+        }
+    }
+
+    bool CpuSupportsAVX2()
+    {
+#if defined(_MSC_VER)
+        int info[4] = { 0 };
+        __cpuid(info, 0);
+        if (info[0] < 7) {
+            return false;
+        }
+        __cpuid(info, 1);
+        const int osxsave = 1 << 27;
+        if ((info[2] & osxsave) == 0 || (_xgetbv(0) & 0x6) != 0x6) {
+            return false;
+        }
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#elif defined(__GNUC__) || defined(__clang__)
+        return __builtin_cpu_supports("avx2");
+#else
+        return false;
+#endif
+    }
+#endif
+
+    ClassifyBlockFunc SelectClassifyBlock()
+    {
+#ifdef MINIJSON_X86_SIMD
+        return CpuSupportsAVX2() ? ClassifyBlockAVX2 : ClassifyBlockSSE2;
+#else
+        return ClassifyBlockScalar;
+#endif
+    }
+
+    inline int CountTrailingZeros(uint64_t value)
+    {
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index = 0;
+        _BitScanForward64(&index, value);
+        return static_cast<int>(index);
+#elif defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(value);
+#else
+        int count = 0;
+        while ((value & 1) == 0) {
+            value >>= 1;
+            count++;
         }
+        return count;
+#endif
     }
 
-    std::string numberStr = m_str.substr(beginPos, m_pos - beginPos);
-    if (numberStr.find_last_of("eE.") == std::string::npos) {
-        try {
-            m_tmpNumberLongValue = std::atoll(numberStr.c_str());
-            m_int64Number = true;
-        } catch (...) {
-            Panic("invalid number %lf, pos: %lu", m_tmpNumberLongValue, beginPos);
-        }
-    } else {
-        try {
-            m_tmpNumberDoubleValue = std::atof(numberStr.c_str());
-            m_int64Number = false;
-        } catch (...) {
-            Panic("invalid number %llu, pos: %lu", m_tmpNumberDoubleValue, beginPos);
+    inline int CountLeadingZeros(uint64_t value)
+    {
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index = 0;
+        _BitScanReverse64(&index, value);
+        return 63 - static_cast<int>(index);
+#elif defined(__GNUC__) || defined(__clang__)
+        return __builtin_clzll(value);
+#else
+        int count = 0;
+        while ((value & (static_cast<uint64_t>(1) << 63)) == 0) {
+            value <<= 1;
+            count++;
         }
+        return count;
+#endif
     }
 
-}
+    // 128 bits product of two 64 bits integers
+    inline void FullMultiplication(uint64_t a, uint64_t b, uint64_t& high, uint64_t& low)
+    {
+#if defined(__SIZEOF_INT128__)
+        unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+        high = static_cast<uint64_t>(product >> 64);
+        low = static_cast<uint64_t>(product);
+#elif defined(_MSC_VER) && defined(_M_X64)
+        low = _umul128(a, b, &high);
+#else
+        uint64_t aLow = a & 0xFFFFFFFF;
+        uint64_t aHigh = a >> 32;
+        uint64_t bLow = b & 0xFFFFFFFF;
+        uint64_t bHigh = b >> 32;
+        uint64_t lowLow = aLow * bLow;
+        uint64_t highLow = aHigh * bLow + (lowLow >> 32);
+        uint64_t lowHigh = aLow * bHigh + (highLow & 0xFFFFFFFF);
+        high = aHigh * bHigh + (highLow >> 32) + (lowHigh >> 32);
+        low = (lowHigh << 32) | (lowLow & 0xFFFFFFFF);
+#endif
+    }
 
-double JsonScanner::GetDoubleValue() const { return m_tmpNumberDoubleValue; }
+    inline bool IsDigitChar(char ch)
+    {
+        return '0' <= ch && ch <= '9';
+    }
 
-int64_t JsonScanner::GetLongIntValue() const { return m_tmpNumberLongValue; }
+    // exactly representable powers of ten
+    const double EXACT_POWER_OF_TEN[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
 
-bool JsonScanner::IsNumberLongInt() const { return m_int64Number; }
+    const int64_t SMALLEST_POWER_OF_FIVE = -342;
+    const int64_t LARGEST_POWER_OF_FIVE = 308;
 
-std::string JsonScanner::GetStringValue() const { return m_tmpStrValue; }
+    // 5^q for q in [-342, 308], normalized and truncated to 128 bits (high word, low word), see Eisel-Lemire
+    const uint64_t POWER_OF_FIVE_128[] = {
+        0xeef453d6923bd65a, 0x113faa2906a13b3f, 0x9558b4661b6565f8, 0x4ac7ca59a424c507,
+        0xbaaee17fa23ebf76, 0x5d79bcf00d2df649, 0xe95a99df8ace6f53, 0xf4d82c2c107973dc,
+        0x91d8a02bb6c10594, 0x79071b9b8a4be869, 0xb64ec836a47146f9, 0x9748e2826cdee284,
+        0xe3e27a444d8d98b7, 0xfd1b1b2308169b25, 0x8e6d8c6ab0787f72, 0xfe30f0f5e50e20f7,
+        0xb208ef855c969f4f, 0xbdbd2d335e51a935, 0xde8b2b66b3bc4723, 0xad2c788035e61382,
+        0x8b16fb203055ac76, 0x4c3bcb5021afcc31, 0xaddcb9e83c6b1793, 0xdf4abe242a1bbf3d,
+        0xd953e8624b85dd78, 0xd71d6dad34a2af0d, 0x87d4713d6f33aa6b, 0x8672648c40e5ad68,
+        0xa9c98d8ccb009506, 0x680efdaf511f18c2, 0xd43bf0effdc0ba48, 0x0212bd1b2566def2,
+        0x84a57695fe98746d, 0x014bb630f7604b57, 0xa5ced43b7e3e9188, 0x419ea3bd35385e2d,
+        0xcf42894a5dce35ea, 0x52064cac828675b9, 0x818995ce7aa0e1b2, 0x7343efebd1940993,
+        0xa1ebfb4219491a1f, 0x1014ebe6c5f90bf8, 0xca66fa129f9b60a6, 0xd41a26e077774ef6,
+        0xfd00b897478238d0, 0x8920b098955522b4, 0x9e20735e8cb16382, 0x55b46e5f5d5535b0,
+        0xc5a890362fddbc62, 0xeb2189f734aa831d, 0xf712b443bbd52b7b, 0xa5e9ec7501d523e4,
+        0x9a6bb0aa55653b2d, 0x47b233c92125366e, 0xc1069cd4eabe89f8, 0x999ec0bb696e840a,
+        0xf148440a256e2c76, 0xc00670ea43ca250d, 0x96cd2a865764dbca, 0x380406926a5e5728,
+        0xbc807527ed3e12bc, 0xc605083704f5ecf2, 0xeba09271e88d976b, 0xf7864a44c633682e,
+        0x93445b8731587ea3, 0x7ab3ee6afbe0211d, 0xb8157268fdae9e4c, 0x5960ea05bad82964,
+        0xe61acf033d1a45df, 0x6fb92487298e33bd, 0x8fd0c16206306bab, 0xa5d3b6d479f8e056,
+        0xb3c4f1ba87bc8696, 0x8f48a4899877186c, 0xe0b62e2929aba83c, 0x331acdabfe94de87,
+        0x8c71dcd9ba0b4925, 0x9ff0c08b7f1d0b14, 0xaf8e5410288e1b6f, 0x07ecf0ae5ee44dd9,
+        0xdb71e91432b1a24a, 0xc9e82cd9f69d6150, 0x892731ac9faf056e, 0xbe311c083a225cd2,
+        0xab70fe17c79ac6ca, 0x6dbd630a48aaf406, 0xd64d3d9db981787d, 0x092cbbccdad5b108,
+        0x85f0468293f0eb4e, 0x25bbf56008c58ea5, 0xa76c582338ed2621, 0xaf2af2b80af6f24e,
+        0xd1476e2c07286faa, 0x1af5af660db4aee1, 0x82cca4db847945ca, 0x50d98d9fc890ed4d,
+        0xa37fce126597973c, 0xe50ff107bab528a0, 0xcc5fc196fefd7d0c, 0x1e53ed49a96272c8,
+        0xff77b1fcbebcdc4f, 0x25e8e89c13bb0f7a, 0x9faacf3df73609b1, 0x77b191618c54e9ac,
+        0xc795830d75038c1d, 0xd59df5b9ef6a2417, 0xf97ae3d0d2446f25, 0x4b0573286b44ad1d,
+        0x9becce62836ac577, 0x4ee367f9430aec32, 0xc2e801fb244576d5, 0x229c41f793cda73f,
+        0xf3a20279ed56d48a, 0x6b43527578c1110f, 0x9845418c345644d6, 0x830a13896b78aaa9,
+        0xbe5691ef416bd60c, 0x23cc986bc656d553, 0xedec366b11c6cb8f, 0x2cbfbe86b7ec8aa8,
+        0x94b3a202eb1c3f39, 0x7bf7d71432f3d6a9, 0xb9e08a83a5e34f07, 0xdaf5ccd93fb0cc53,
+        0xe858ad248f5c22c9, 0xd1b3400f8f9cff68, 0x91376c36d99995be, 0x23100809b9c21fa1,
+        0xb58547448ffffb2d, 0xabd40a0c2832a78a, 0xe2e69915b3fff9f9, 0x16c90c8f323f516c,
+        0x8dd01fad907ffc3b, 0xae3da7d97f6792e3, 0xb1442798f49ffb4a, 0x99cd11cfdf41779c,
+        0xdd95317f31c7fa1d, 0x40405643d711d583, 0x8a7d3eef7f1cfc52, 0x482835ea666b2572,
+        0xad1c8eab5ee43b66, 0xda3243650005eecf, 0xd863b256369d4a40, 0x90bed43e40076a82,
+        0x873e4f75e2224e68, 0x5a7744a6e804a291, 0xa90de3535aaae202, 0x711515d0a205cb36,
+        0xd3515c2831559a83, 0x0d5a5b44ca873e03, 0x8412d9991ed58091, 0xe858790afe9486c2,
+        0xa5178fff668ae0b6, 0x626e974dbe39a872, 0xce5d73ff402d98e3, 0xfb0a3d212dc8128f,
+        0x80fa687f881c7f8e, 0x7ce66634bc9d0b99, 0xa139029f6a239f72, 0x1c1fffc1ebc44e80,
+        0xc987434744ac874e, 0xa327ffb266b56220, 0xfbe9141915d7a922, 0x4bf1ff9f0062baa8,
+        0x9d71ac8fada6c9b5, 0x6f773fc3603db4a9, 0xc4ce17b399107c22, 0xcb550fb4384d21d3,
+        0xf6019da07f549b2b, 0x7e2a53a146606a48, 0x99c102844f94e0fb, 0x2eda7444cbfc426d,
+        0xc0314325637a1939, 0xfa911155fefb5308, 0xf03d93eebc589f88, 0x793555ab7eba27ca,
+        0x96267c7535b763b5, 0x4bc1558b2f3458de, 0xbbb01b9283253ca2, 0x9eb1aaedfb016f16,
+        0xea9c227723ee8bcb, 0x465e15a979c1cadc, 0x92a1958a7675175f, 0x0bfacd89ec191ec9,
+        0xb749faed14125d36, 0xcef980ec671f667b, 0xe51c79a85916f484, 0x82b7e12780e7401a,
+        0x8f31cc0937ae58d2, 0xd1b2ecb8b0908810, 0xb2fe3f0b8599ef07, 0x861fa7e6dcb4aa15,
+        0xdfbdcece67006ac9, 0x67a791e093e1d49a, 0x8bd6a141006042bd, 0xe0c8bb2c5c6d24e0,
+        0xaecc49914078536d, 0x58fae9f773886e18, 0xda7f5bf590966848, 0xaf39a475506a899e,
+        0x888f99797a5e012d, 0x6d8406c952429603, 0xaab37fd7d8f58178, 0xc8e5087ba6d33b83,
+        0xd5605fcdcf32e1d6, 0xfb1e4a9a90880a64, 0x855c3be0a17fcd26, 0x5cf2eea09a55067f,
+        0xa6b34ad8c9dfc06f, 0xf42faa48c0ea481e, 0xd0601d8efc57b08b, 0xf13b94daf124da26,
+        0x823c12795db6ce57, 0x76c53d08d6b70858, 0xa2cb1717b52481ed, 0x54768c4b0c64ca6e,
+        0xcb7ddcdda26da268, 0xa9942f5dcf7dfd09, 0xfe5d54150b090b02, 0xd3f93b35435d7c4c,
+        0x9efa548d26e5a6e1, 0xc47bc5014a1a6daf, 0xc6b8e9b0709f109a, 0x359ab6419ca1091b,
+        0xf867241c8cc6d4c0, 0xc30163d203c94b62, 0x9b407691d7fc44f8, 0x79e0de63425dcf1d,
+        0xc21094364dfb5636, 0x985915fc12f542e4, 0xf294b943e17a2bc4, 0x3e6f5b7b17b2939d,
+        0x979cf3ca6cec5b5a, 0xa705992ceecf9c42, 0xbd8430bd08277231, 0x50c6ff782a838353,
+        0xece53cec4a314ebd, 0xa4f8bf5635246428, 0x940f4613ae5ed136, 0x871b7795e136be99,
+        0xb913179899f68584, 0x28e2557b59846e3f, 0xe757dd7ec07426e5, 0x331aeada2fe589cf,
+        0x9096ea6f3848984f, 0x3ff0d2c85def7621, 0xb4bca50b065abe63, 0x0fed077a756b53a9,
+        0xe1ebce4dc7f16dfb, 0xd3e8495912c62894, 0x8d3360f09cf6e4bd, 0x64712dd7abbbd95c,
+        0xb080392cc4349dec, 0xbd8d794d96aacfb3, 0xdca04777f541c567, 0xecf0d7a0fc5583a0,
+        0x89e42caaf9491b60, 0xf41686c49db57244, 0xac5d37d5b79b6239, 0x311c2875c522ced5,
+        0xd77485cb25823ac7, 0x7d633293366b828b, 0x86a8d39ef77164bc, 0xae5dff9c02033197,
+        0xa8530886b54dbdeb, 0xd9f57f830283fdfc, 0xd267caa862a12d66, 0xd072df63c324fd7b,
+        0x8380dea93da4bc60, 0x4247cb9e59f71e6d, 0xa46116538d0deb78, 0x52d9be85f074e608,
+        0xcd795be870516656, 0x67902e276c921f8b, 0x806bd9714632dff6, 0x00ba1cd8a3db53b6,
+        0xa086cfcd97bf97f3, 0x80e8a40eccd228a4, 0xc8a883c0fdaf7df0, 0x6122cd128006b2cd,
+        0xfad2a4b13d1b5d6c, 0x796b805720085f81, 0x9cc3a6eec6311a63, 0xcbe3303674053bb0,
+        0xc3f490aa77bd60fc, 0xbedbfc4411068a9c, 0xf4f1b4d515acb93b, 0xee92fb5515482d44,
+        0x991711052d8bf3c5, 0x751bdd152d4d1c4a, 0xbf5cd54678eef0b6, 0xd262d45a78a0635d,
+        0xef340a98172aace4, 0x86fb897116c87c34, 0x9580869f0e7aac0e, 0xd45d35e6ae3d4da0,
+        0xbae0a846d2195712, 0x8974836059cca109, 0xe998d258869facd7, 0x2bd1a438703fc94b,
+        0x91ff83775423cc06, 0x7b6306a34627ddcf, 0xb67f6455292cbf08, 0x1a3bc84c17b1d542,
+        0xe41f3d6a7377eeca, 0x20caba5f1d9e4a93, 0x8e938662882af53e, 0x547eb47b7282ee9c,
+        0xb23867fb2a35b28d, 0xe99e619a4f23aa43, 0xdec681f9f4c31f31, 0x6405fa00e2ec94d4,
+        0x8b3c113c38f9f37e, 0xde83bc408dd3dd04, 0xae0b158b4738705e, 0x9624ab50b148d445,
+        0xd98ddaee19068c76, 0x3badd624dd9b0957, 0x87f8a8d4cfa417c9, 0xe54ca5d70a80e5d6,
+        0xa9f6d30a038d1dbc, 0x5e9fcf4ccd211f4c, 0xd47487cc8470652b, 0x7647c3200069671f,
+        0x84c8d4dfd2c63f3b, 0x29ecd9f40041e073, 0xa5fb0a17c777cf09, 0xf468107100525890,
+        0xcf79cc9db955c2cc, 0x7182148d4066eeb4, 0x81ac1fe293d599bf, 0xc6f14cd848405530,
+        0xa21727db38cb002f, 0xb8ada00e5a506a7c, 0xca9cf1d206fdc03b, 0xa6d90811f0e4851c,
+        0xfd442e4688bd304a, 0x908f4a166d1da663, 0x9e4a9cec15763e2e, 0x9a598e4e043287fe,
+        0xc5dd44271ad3cdba, 0x40eff1e1853f29fd, 0xf7549530e188c128, 0xd12bee59e68ef47c,
+        0x9a94dd3e8cf578b9, 0x82bb74f8301958ce, 0xc13a148e3032d6e7, 0xe36a52363c1faf01,
+        0xf18899b1bc3f8ca1, 0xdc44e6c3cb279ac1, 0x96f5600f15a7b7e5, 0x29ab103a5ef8c0b9,
+        0xbcb2b812db11a5de, 0x7415d448f6b6f0e7, 0xebdf661791d60f56, 0x111b495b3464ad21,
+        0x936b9fcebb25c995, 0xcab10dd900beec34, 0xb84687c269ef3bfb, 0x3d5d514f40eea742,
+        0xe65829b3046b0afa, 0x0cb4a5a3112a5112, 0x8ff71a0fe2c2e6dc, 0x47f0e785eaba72ab,
+        0xb3f4e093db73a093, 0x59ed216765690f56, 0xe0f218b8d25088b8, 0x306869c13ec3532c,
+        0x8c974f7383725573, 0x1e414218c73a13fb, 0xafbd2350644eeacf, 0xe5d1929ef90898fa,
+        0xdbac6c247d62a583, 0xdf45f746b74abf39, 0x894bc396ce5da772, 0x6b8bba8c328eb783,
+        0xab9eb47c81f5114f, 0x066ea92f3f326564, 0xd686619ba27255a2, 0xc80a537b0efefebd,
+        0x8613fd0145877585, 0xbd06742ce95f5f36, 0xa798fc4196e952e7, 0x2c48113823b73704,
+        0xd17f3b51fca3a7a0, 0xf75a15862ca504c5, 0x82ef85133de648c4, 0x9a984d73dbe722fb,
+        0xa3ab66580d5fdaf5, 0xc13e60d0d2e0ebba, 0xcc963fee10b7d1b3, 0x318df905079926a8,
+        0xffbbcfe994e5c61f, 0xfdf17746497f7052, 0x9fd561f1fd0f9bd3, 0xfeb6ea8bedefa633,
+        0xc7caba6e7c5382c8, 0xfe64a52ee96b8fc0, 0xf9bd690a1b68637b, 0x3dfdce7aa3c673b0,
+        0x9c1661a651213e2d, 0x06bea10ca65c084e, 0xc31bfa0fe5698db8, 0x486e494fcff30a62,
+        0xf3e2f893dec3f126, 0x5a89dba3c3efccfa, 0x986ddb5c6b3a76b7, 0xf89629465a75e01c,
+        0xbe89523386091465, 0xf6bbb397f1135823, 0xee2ba6c0678b597f, 0x746aa07ded582e2c,
+        0x94db483840b717ef, 0xa8c2a44eb4571cdc, 0xba121a4650e4ddeb, 0x92f34d62616ce413,
+        0xe896a0d7e51e1566, 0x77b020baf9c81d17, 0x915e2486ef32cd60, 0x0ace1474dc1d122e,
+        0xb5b5ada8aaff80b8, 0x0d819992132456ba, 0xe3231912d5bf60e6, 0x10e1fff697ed6c69,
+        0x8df5efabc5979c8f, 0xca8d3ffa1ef463c1, 0xb1736b96b6fd83b3, 0xbd308ff8a6b17cb2,
+        0xddd0467c64bce4a0, 0xac7cb3f6d05ddbde, 0x8aa22c0dbef60ee4, 0x6bcdf07a423aa96b,
+        0xad4ab7112eb3929d, 0x86c16c98d2c953c6, 0xd89d64d57a607744, 0xe871c7bf077ba8b7,
+        0x87625f056c7c4a8b, 0x11471cd764ad4972, 0xa93af6c6c79b5d2d, 0xd598e40d3dd89bcf,
+        0xd389b47879823479, 0x4aff1d108d4ec2c3, 0x843610cb4bf160cb, 0xcedf722a585139ba,
+        0xa54394fe1eedb8fe, 0xc2974eb4ee658828, 0xce947a3da6a9273e, 0x733d226229feea32,
+        0x811ccc668829b887, 0x0806357d5a3f525f, 0xa163ff802a3426a8, 0xca07c2dcb0cf26f7,
+        0xc9bcff6034c13052, 0xfc89b393dd02f0b5, 0xfc2c3f3841f17c67, 0xbbac2078d443ace2,
+        0x9d9ba7832936edc0, 0xd54b944b84aa4c0d, 0xc5029163f384a931, 0x0a9e795e65d4df11,
+        0xf64335bcf065d37d, 0x4d4617b5ff4a16d5, 0x99ea0196163fa42e, 0x504bced1bf8e4e45,
+        0xc06481fb9bcf8d39, 0xe45ec2862f71e1d6, 0xf07da27a82c37088, 0x5d767327bb4e5a4c,
+        0x964e858c91ba2655, 0x3a6a07f8d510f86f, 0xbbe226efb628afea, 0x890489f70a55368b,
+        0xeadab0aba3b2dbe5, 0x2b45ac74ccea842e, 0x92c8ae6b464fc96f, 0x3b0b8bc90012929d,
+        0xb77ada0617e3bbcb, 0x09ce6ebb40173744, 0xe55990879ddcaabd, 0xcc420a6a101d0515,
+        0x8f57fa54c2a9eab6, 0x9fa946824a12232d, 0xb32df8e9f3546564, 0x47939822dc96abf9,
+        0xdff9772470297ebd, 0x59787e2b93bc56f7, 0x8bfbea76c619ef36, 0x57eb4edb3c55b65a,
+        0xaefae51477a06b03, 0xede622920b6b23f1, 0xdab99e59958885c4, 0xe95fab368e45eced,
+        0x88b402f7fd75539b, 0x11dbcb0218ebb414, 0xaae103b5fcd2a881, 0xd652bdc29f26a119,
+        0xd59944a37c0752a2, 0x4be76d3346f0495f, 0x857fcae62d8493a5, 0x6f70a4400c562ddb,
+        0xa6dfbd9fb8e5b88e, 0xcb4ccd500f6bb952, 0xd097ad07a71f26b2, 0x7e2000a41346a7a7,
+        0x825ecc24c873782f, 0x8ed400668c0c28c8, 0xa2f67f2dfa90563b, 0x728900802f0f32fa,
+        0xcbb41ef979346bca, 0x4f2b40a03ad2ffb9, 0xfea126b7d78186bc, 0xe2f610c84987bfa8,
+        0x9f24b832e6b0f436, 0x0dd9ca7d2df4d7c9, 0xc6ede63fa05d3143, 0x91503d1c79720dbb,
+        0xf8a95fcf88747d94, 0x75a44c6397ce912a, 0x9b69dbe1b548ce7c, 0xc986afbe3ee11aba,
+        0xc24452da229b021b, 0xfbe85badce996168, 0xf2d56790ab41c2a2, 0xfae27299423fb9c3,
+        0x97c560ba6b0919a5, 0xdccd879fc967d41a, 0xbdb6b8e905cb600f, 0x5400e987bbc1c920,
+        0xed246723473e3813, 0x290123e9aab23b68, 0x9436c0760c86e30b, 0xf9a0b6720aaf6521,
+        0xb94470938fa89bce, 0xf808e40e8d5b3e69, 0xe7958cb87392c2c2, 0xb60b1d1230b20e04,
+        0x90bd77f3483bb9b9, 0xb1c6f22b5e6f48c2, 0xb4ecd5f01a4aa828, 0x1e38aeb6360b1af3,
+        0xe2280b6c20dd5232, 0x25c6da63c38de1b0, 0x8d590723948a535f, 0x579c487e5a38ad0e,
+        0xb0af48ec79ace837, 0x2d835a9df0c6d851, 0xdcdb1b2798182244, 0xf8e431456cf88e65,
+        0x8a08f0f8bf0f156b, 0x1b8e9ecb641b58ff, 0xac8b2d36eed2dac5, 0xe272467e3d222f3f,
+        0xd7adf884aa879177, 0x5b0ed81dcc6abb0f, 0x86ccbb52ea94baea, 0x98e947129fc2b4e9,
+        0xa87fea27a539e9a5, 0x3f2398d747b36224, 0xd29fe4b18e88640e, 0x8eec7f0d19a03aad,
+        0x83a3eeeef9153e89, 0x1953cf68300424ac, 0xa48ceaaab75a8e2b, 0x5fa8c3423c052dd7,
+        0xcdb02555653131b6, 0x3792f412cb06794d, 0x808e17555f3ebf11, 0xe2bbd88bbee40bd0,
+        0xa0b19d2ab70e6ed6, 0x5b6aceaeae9d0ec4, 0xc8de047564d20a8b, 0xf245825a5a445275,
+        0xfb158592be068d2e, 0xeed6e2f0f0d56712, 0x9ced737bb6c4183d, 0x55464dd69685606b,
+        0xc428d05aa4751e4c, 0xaa97e14c3c26b886, 0xf53304714d9265df, 0xd53dd99f4b3066a8,
+        0x993fe2c6d07b7fab, 0xe546a8038efe4029, 0xbf8fdb78849a5f96, 0xde98520472bdd033,
+        0xef73d256a5c0f77c, 0x963e66858f6d4440, 0x95a8637627989aad, 0xdde7001379a44aa8,
+        0xbb127c53b17ec159, 0x5560c018580d5d52, 0xe9d71b689dde71af, 0xaab8f01e6e10b4a6,
+        0x9226712162ab070d, 0xcab3961304ca70e8, 0xb6b00d69bb55c8d1, 0x3d607b97c5fd0d22,
+        0xe45c10c42a2b3b05, 0x8cb89a7db77c506a, 0x8eb98a7a9a5b04e3, 0x77f3608e92adb242,
+        0xb267ed1940f1c61c, 0x55f038b237591ed3, 0xdf01e85f912e37a3, 0x6b6c46dec52f6688,
+        0x8b61313bbabce2c6, 0x2323ac4b3b3da015, 0xae397d8aa96c1b77, 0xabec975e0a0d081a,
+        0xd9c7dced53c72255, 0x96e7bd358c904a21, 0x881cea14545c7575, 0x7e50d64177da2e54,
+        0xaa242499697392d2, 0xdde50bd1d5d0b9e9, 0xd4ad2dbfc3d07787, 0x955e4ec64b44e864,
+        0x84ec3c97da624ab4, 0xbd5af13bef0b113e, 0xa6274bbdd0fadd61, 0xecb1ad8aeacdd58e,
+        0xcfb11ead453994ba, 0x67de18eda5814af2, 0x81ceb32c4b43fcf4, 0x80eacf948770ced7,
+        0xa2425ff75e14fc31, 0xa1258379a94d028d, 0xcad2f7f5359a3b3e, 0x096ee45813a04330,
+        0xfd87b5f28300ca0d, 0x8bca9d6e188853fc, 0x9e74d1b791e07e48, 0x775ea264cf55347e,
+        0xc612062576589dda, 0x95364afe032a819e, 0xf79687aed3eec551, 0x3a83ddbd83f52205,
+        0x9abe14cd44753b52, 0xc4926a9672793543, 0xc16d9a0095928a27, 0x75b7053c0f178294,
+        0xf1c90080baf72cb1, 0x5324c68b12dd6339, 0x971da05074da7bee, 0xd3f6fc16ebca5e04,
+        0xbce5086492111aea, 0x88f4bb1ca6bcf585, 0xec1e4a7db69561a5, 0x2b31e9e3d06c32e6,
+        0x9392ee8e921d5d07, 0x3aff322e62439fd0, 0xb877aa3236a4b449, 0x09befeb9fad487c3,
+        0xe69594bec44de15b, 0x4c2ebe687989a9b4, 0x901d7cf73ab0acd9, 0x0f9d37014bf60a11,
+        0xb424dc35095cd80f, 0x538484c19ef38c95, 0xe12e13424bb40e13, 0x2865a5f206b06fba,
+        0x8cbccc096f5088cb, 0xf93f87b7442e45d4, 0xafebff0bcb24aafe, 0xf78f69a51539d749,
+        0xdbe6fecebdedd5be, 0xb573440e5a884d1c, 0x89705f4136b4a597, 0x31680a88f8953031,
+        0xabcc77118461cefc, 0xfdc20d2b36ba7c3e, 0xd6bf94d5e57a42bc, 0x3d32907604691b4d,
+        0x8637bd05af6c69b5, 0xa63f9a49c2c1b110, 0xa7c5ac471b478423, 0x0fcf80dc33721d54,
+        0xd1b71758e219652b, 0xd3c36113404ea4a9, 0x83126e978d4fdf3b, 0x645a1cac083126ea,
+        0xa3d70a3d70a3d70a, 0x3d70a3d70a3d70a4, 0xcccccccccccccccc, 0xcccccccccccccccd,
+        0x8000000000000000, 0x0000000000000000, 0xa000000000000000, 0x0000000000000000,
+        0xc800000000000000, 0x0000000000000000, 0xfa00000000000000, 0x0000000000000000,
+        0x9c40000000000000, 0x0000000000000000, 0xc350000000000000, 0x0000000000000000,
+        0xf424000000000000, 0x0000000000000000, 0x9896800000000000, 0x0000000000000000,
+        0xbebc200000000000, 0x0000000000000000, 0xee6b280000000000, 0x0000000000000000,
+        0x9502f90000000000, 0x0000000000000000, 0xba43b74000000000, 0x0000000000000000,
+        0xe8d4a51000000000, 0x0000000000000000, 0x9184e72a00000000, 0x0000000000000000,
+        0xb5e620f480000000, 0x0000000000000000, 0xe35fa931a0000000, 0x0000000000000000,
+        0x8e1bc9bf04000000, 0x0000000000000000, 0xb1a2bc2ec5000000, 0x0000000000000000,
+        0xde0b6b3a76400000, 0x0000000000000000, 0x8ac7230489e80000, 0x0000000000000000,
+        0xad78ebc5ac620000, 0x0000000000000000, 0xd8d726b7177a8000, 0x0000000000000000,
+        0x878678326eac9000, 0x0000000000000000, 0xa968163f0a57b400, 0x0000000000000000,
+        0xd3c21bcecceda100, 0x0000000000000000, 0x84595161401484a0, 0x0000000000000000,
+        0xa56fa5b99019a5c8, 0x0000000000000000, 0xcecb8f27f4200f3a, 0x0000000000000000,
+        0x813f3978f8940984, 0x4000000000000000, 0xa18f07d736b90be5, 0x5000000000000000,
+        0xc9f2c9cd04674ede, 0xa400000000000000, 0xfc6f7c4045812296, 0x4d00000000000000,
+        0x9dc5ada82b70b59d, 0xf020000000000000, 0xc5371912364ce305, 0x6c28000000000000,
+        0xf684df56c3e01bc6, 0xc732000000000000, 0x9a130b963a6c115c, 0x3c7f400000000000,
+        0xc097ce7bc90715b3, 0x4b9f100000000000, 0xf0bdc21abb48db20, 0x1e86d40000000000,
+        0x96769950b50d88f4, 0x1314448000000000, 0xbc143fa4e250eb31, 0x17d955a000000000,
+        0xeb194f8e1ae525fd, 0x5dcfab0800000000, 0x92efd1b8d0cf37be, 0x5aa1cae500000000,
+        0xb7abc627050305ad, 0xf14a3d9e40000000, 0xe596b7b0c643c719, 0x6d9ccd05d0000000,
+        0x8f7e32ce7bea5c6f, 0xe4820023a2000000, 0xb35dbf821ae4f38b, 0xdda2802c8a800000,
+        0xe0352f62a19e306e, 0xd50b2037ad200000, 0x8c213d9da502de45, 0x4526f422cc340000,
+        0xaf298d050e4395d6, 0x9670b12b7f410000, 0xdaf3f04651d47b4c, 0x3c0cdd765f114000,
+        0x88d8762bf324cd0f, 0xa5880a69fb6ac800, 0xab0e93b6efee0053, 0x8eea0d047a457a00,
+        0xd5d238a4abe98068, 0x72a4904598d6d880, 0x85a36366eb71f041, 0x47a6da2b7f864750,
+        0xa70c3c40a64e6c51, 0x999090b65f67d924, 0xd0cf4b50cfe20765, 0xfff4b4e3f741cf6d,
+        0x82818f1281ed449f, 0xbff8f10e7a8921a4, 0xa321f2d7226895c7, 0xaff72d52192b6a0d,
+        0xcbea6f8ceb02bb39, 0x9bf4f8a69f764490, 0xfee50b7025c36a08, 0x02f236d04753d5b4,
+        0x9f4f2726179a2245, 0x01d762422c946590, 0xc722f0ef9d80aad6, 0x424d3ad2b7b97ef5,
+        0xf8ebad2b84e0d58b, 0xd2e0898765a7deb2, 0x9b934c3b330c8577, 0x63cc55f49f88eb2f,
+        0xc2781f49ffcfa6d5, 0x3cbf6b71c76b25fb, 0xf316271c7fc3908a, 0x8bef464e3945ef7a,
+        0x97edd871cfda3a56, 0x97758bf0e3cbb5ac, 0xbde94e8e43d0c8ec, 0x3d52eeed1cbea317,
+        0xed63a231d4c4fb27, 0x4ca7aaa863ee4bdd, 0x945e455f24fb1cf8, 0x8fe8caa93e74ef6a,
+        0xb975d6b6ee39e436, 0xb3e2fd538e122b44, 0xe7d34c64a9c85d44, 0x60dbbca87196b616,
+        0x90e40fbeea1d3a4a, 0xbc8955e946fe31cd, 0xb51d13aea4a488dd, 0x6babab6398bdbe41,
+        0xe264589a4dcdab14, 0xc696963c7eed2dd1, 0x8d7eb76070a08aec, 0xfc1e1de5cf543ca2,
+        0xb0de65388cc8ada8, 0x3b25a55f43294bcb, 0xdd15fe86affad912, 0x49ef0eb713f39ebe,
+        0x8a2dbf142dfcc7ab, 0x6e3569326c784337, 0xacb92ed9397bf996, 0x49c2c37f07965404,
+        0xd7e77a8f87daf7fb, 0xdc33745ec97be906, 0x86f0ac99b4e8dafd, 0x69a028bb3ded71a3,
+        0xa8acd7c0222311bc, 0xc40832ea0d68ce0c, 0xd2d80db02aabd62b, 0xf50a3fa490c30190,
+        0x83c7088e1aab65db, 0x792667c6da79e0fa, 0xa4b8cab1a1563f52, 0x577001b891185938,
+        0xcde6fd5e09abcf26, 0xed4c0226b55e6f86, 0x80b05e5ac60b6178, 0x544f8158315b05b4,
+        0xa0dc75f1778e39d6, 0x696361ae3db1c721, 0xc913936dd571c84c, 0x03bc3a19cd1e38e9,
+        0xfb5878494ace3a5f, 0x04ab48a04065c723, 0x9d174b2dcec0e47b, 0x62eb0d64283f9c76,
+        0xc45d1df942711d9a, 0x3ba5d0bd324f8394, 0xf5746577930d6500, 0xca8f44ec7ee36479,
+        0x9968bf6abbe85f20, 0x7e998b13cf4e1ecb, 0xbfc2ef456ae276e8, 0x9e3fedd8c321a67e,
+        0xefb3ab16c59b14a2, 0xc5cfe94ef3ea101e, 0x95d04aee3b80ece5, 0xbba1f1d158724a12,
+        0xbb445da9ca61281f, 0x2a8a6e45ae8edc97, 0xea1575143cf97226, 0xf52d09d71a3293bd,
+        0x924d692ca61be758, 0x593c2626705f9c56, 0xb6e0c377cfa2e12e, 0x6f8b2fb00c77836c,
+        0xe498f455c38b997a, 0x0b6dfb9c0f956447, 0x8edf98b59a373fec, 0x4724bd4189bd5eac,
+        0xb2977ee300c50fe7, 0x58edec91ec2cb657, 0xdf3d5e9bc0f653e1, 0x2f2967b66737e3ed,
+        0x8b865b215899f46c, 0xbd79e0d20082ee74, 0xae67f1e9aec07187, 0xecd8590680a3aa11,
+        0xda01ee641a708de9, 0xe80e6f4820cc9495, 0x884134fe908658b2, 0x3109058d147fdcdd,
+        0xaa51823e34a7eede, 0xbd4b46f0599fd415, 0xd4e5e2cdc1d1ea96, 0x6c9e18ac7007c91a,
+        0x850fadc09923329e, 0x03e2cf6bc604ddb0, 0xa6539930bf6bff45, 0x84db8346b786151c,
+        0xcfe87f7cef46ff16, 0xe612641865679a63, 0x81f14fae158c5f6e, 0x4fcb7e8f3f60c07e,
+        0xa26da3999aef7749, 0xe3be5e330f38f09d, 0xcb090c8001ab551c, 0x5cadf5bfd3072cc5,
+        0xfdcb4fa002162a63, 0x73d9732fc7c8f7f6, 0x9e9f11c4014dda7e, 0x2867e7fddcdd9afa,
+        0xc646d63501a1511d, 0xb281e1fd541501b8, 0xf7d88bc24209a565, 0x1f225a7ca91a4226,
+        0x9ae757596946075f, 0x3375788de9b06958, 0xc1a12d2fc3978937, 0x0052d6b1641c83ae,
+        0xf209787bb47d6b84, 0xc0678c5dbd23a49a, 0x9745eb4d50ce6332, 0xf840b7ba963646e0,
+        0xbd176620a501fbff, 0xb650e5a93bc3d898, 0xec5d3fa8ce427aff, 0xa3e51f138ab4cebe,
+        0x93ba47c980e98cdf, 0xc66f336c36b10137, 0xb8a8d9bbe123f017, 0xb80b0047445d4184,
+        0xe6d3102ad96cec1d, 0xa60dc059157491e5, 0x9043ea1ac7e41392, 0x87c89837ad68db2f,
+        0xb454e4a179dd1877, 0x29babe4598c311fb, 0xe16a1dc9d8545e94, 0xf4296dd6fef3d67a,
+        0x8ce2529e2734bb1d, 0x1899e4a65f58660c, 0xb01ae745b101e9e4, 0x5ec05dcff72e7f8f,
+        0xdc21a1171d42645d, 0x76707543f4fa1f73, 0x899504ae72497eba, 0x6a06494a791c53a8,
+        0xabfa45da0edbde69, 0x0487db9d17636892, 0xd6f8d7509292d603, 0x45a9d2845d3c42b6,
+        0x865b86925b9bc5c2, 0x0b8a2392ba45a9b2, 0xa7f26836f282b732, 0x8e6cac7768d7141e,
+        0xd1ef0244af2364ff, 0x3207d795430cd926, 0x8335616aed761f1f, 0x7f44e6bd49e807b8,
+        0xa402b9c5a8d3a6e7, 0x5f16206c9c6209a6, 0xcd036837130890a1, 0x36dba887c37a8c0f,
+        0x802221226be55a64, 0xc2494954da2c9789, 0xa02aa96b06deb0fd, 0xf2db9baa10b7bd6c,
+        0xc83553c5c8965d3d, 0x6f92829494e5acc7, 0xfa42a8b73abbf48c, 0xcb772339ba1f17f9,
+        0x9c69a97284b578d7, 0xff2a760414536efb, 0xc38413cf25e2d70d, 0xfef5138519684aba,
+        0xf46518c2ef5b8cd1, 0x7eb258665fc25d69, 0x98bf2f79d5993802, 0xef2f773ffbd97a61,
+        0xbeeefb584aff8603, 0xaafb550ffacfd8fa, 0xeeaaba2e5dbf6784, 0x95ba2a53f983cf38,
+        0x952ab45cfa97a0b2, 0xdd945a747bf26183, 0xba756174393d88df, 0x94f971119aeef9e4,
+        0xe912b9d1478ceb17, 0x7a37cd5601aab85d, 0x91abb422ccb812ee, 0xac62e055c10ab33a,
+        0xb616a12b7fe617aa, 0x577b986b314d6009, 0xe39c49765fdf9d94, 0xed5a7e85fda0b80b,
+        0x8e41ade9fbebc27d, 0x14588f13be847307, 0xb1d219647ae6b31c, 0x596eb2d8ae258fc8,
+        0xde469fbd99a05fe3, 0x6fca5f8ed9aef3bb, 0x8aec23d680043bee, 0x25de7bb9480d5854,
+        0xada72ccc20054ae9, 0xaf561aa79a10ae6a, 0xd910f7ff28069da4, 0x1b2ba1518094da04,
+        0x87aa9aff79042286, 0x90fb44d2f05d0842, 0xa99541bf57452b28, 0x353a1607ac744a53,
+        0xd3fa922f2d1675f2, 0x42889b8997915ce8, 0x847c9b5d7c2e09b7, 0x69956135febada11,
+        0xa59bc234db398c25, 0x43fab9837e699095, 0xcf02b2c21207ef2e, 0x94f967e45e03f4bb,
+        0x8161afb94b44f57d, 0x1d1be0eebac278f5, 0xa1ba1ba79e1632dc, 0x6462d92a69731732,
+        0xca28a291859bbf93, 0x7d7b8f7503cfdcfe, 0xfcb2cb35e702af78, 0x5cda735244c3d43e,
+        0x9defbf01b061adab, 0x3a0888136afa64a7, 0xc56baec21c7a1916, 0x088aaa1845b8fdd0,
+        0xf6c69a72a3989f5b, 0x8aad549e57273d45, 0x9a3c2087a63f6399, 0x36ac54e2f678864b,
+        0xc0cb28a98fcf3c7f, 0x84576a1bb416a7dd, 0xf0fdf2d3f3c30b9f, 0x656d44a2a11c51d5,
+        0x969eb7c47859e743, 0x9f644ae5a4b1b325, 0xbc4665b596706114, 0x873d5d9f0dde1fee,
+        0xeb57ff22fc0c7959, 0xa90cb506d155a7ea, 0x9316ff75dd87cbd8, 0x09a7f12442d588f2,
+        0xb7dcbf5354e9bece, 0x0c11ed6d538aeb2f, 0xe5d3ef282a242e81, 0x8f1668c8a86da5fa,
+        0x8fa475791a569d10, 0xf96e017d694487bc, 0xb38d92d760ec4455, 0x37c981dcc395a9ac,
+        0xe070f78d3927556a, 0x85bbe253f47b1417, 0x8c469ab843b89562, 0x93956d7478ccec8e,
+        0xaf58416654a6babb, 0x387ac8d1970027b2, 0xdb2e51bfe9d0696a, 0x06997b05fcc0319e,
+        0x88fcf317f22241e2, 0x441fece3bdf81f03, 0xab3c2fddeeaad25a, 0xd527e81cad7626c3,
+        0xd60b3bd56a5586f1, 0x8a71e223d8d3b074, 0x85c7056562757456, 0xf6872d5667844e49,
+        0xa738c6bebb12d16c, 0xb428f8ac016561db, 0xd106f86e69d785c7, 0xe13336d701beba52,
+        0x82a45b450226b39c, 0xecc0024661173473, 0xa34d721642b06084, 0x27f002d7f95d0190,
+        0xcc20ce9bd35c78a5, 0x31ec038df7b441f4, 0xff290242c83396ce, 0x7e67047175a15271,
+        0x9f79a169bd203e41, 0x0f0062c6e984d386, 0xc75809c42c684dd1, 0x52c07b78a3e60868,
+        0xf92e0c3537826145, 0xa7709a56ccdf8a82, 0x9bbcc7a142b17ccb, 0x88a66076400bb691,
+        0xc2abf989935ddbfe, 0x6acff893d00ea435, 0xf356f7ebf83552fe, 0x0583f6b8c4124d43,
+        0x98165af37b2153de, 0xc3727a337a8b704a, 0xbe1bf1b059e9a8d6, 0x744f18c0592e4c5c,
+        0xeda2ee1c7064130c, 0x1162def06f79df73, 0x9485d4d1c63e8be7, 0x8addcb5645ac2ba8,
+        0xb9a74a0637ce2ee1, 0x6d953e2bd7173692, 0xe8111c87c5c1ba99, 0xc8fa8db6ccdd0437,
+        0x910ab1d4db9914a0, 0x1d9c9892400a22a2, 0xb54d5e4a127f59c8, 0x2503beb6d00cab4b,
+        0xe2a0b5dc971f303a, 0x2e44ae64840fd61d, 0x8da471a9de737e24, 0x5ceaecfed289e5d2,
+        0xb10d8e1456105dad, 0x7425a83e872c5f47, 0xdd50f1996b947518, 0xd12f124e28f77719,
+        0x8a5296ffe33cc92f, 0x82bd6b70d99aaa6f, 0xace73cbfdc0bfb7b, 0x636cc64d1001550b,
+        0xd8210befd30efa5a, 0x3c47f7e05401aa4e, 0x8714a775e3e95c78, 0x65acfaec34810a71,
+        0xa8d9d1535ce3b396, 0x7f1839a741a14d0d, 0xd31045a8341ca07c, 0x1ede48111209a050,
+        0x83ea2b892091e44d, 0x934aed0aab460432, 0xa4e4b66b68b65d60, 0xf81da84d5617853f,
+        0xce1de40642e3f4b9, 0x36251260ab9d668e, 0x80d2ae83e9ce78f3, 0xc1d72b7c6b426019,
+        0xa1075a24e4421730, 0xb24cf65b8612f81f, 0xc94930ae1d529cfc, 0xdee033f26797b627,
+        0xfb9b7cd9a4a7443c, 0x169840ef017da3b1, 0x9d412e0806e88aa5, 0x8e1f289560ee864e,
+        0xc491798a08a2ad4e, 0xf1a6f2bab92a27e2, 0xf5b5d7ec8acb58a2, 0xae10af696774b1db,
+        0x9991a6f3d6bf1765, 0xacca6da1e0a8ef29, 0xbff610b0cc6edd3f, 0x17fd090a58d32af3,
+        0xeff394dcff8a948e, 0xddfc4b4cef07f5b0, 0x95f83d0a1fb69cd9, 0x4abdaf101564f98e,
+        0xbb764c4ca7a4440f, 0x9d6d1ad41abe37f1, 0xea53df5fd18d5513, 0x84c86189216dc5ed,
+        0x92746b9be2f8552c, 0x32fd3cf5b4e49bb4, 0xb7118682dbb66a77, 0x3fbc8c33221dc2a1,
+        0xe4d5e82392a40515, 0x0fabaf3feaa5334a, 0x8f05b1163ba6832d, 0x29cb4d87f2a7400e,
+        0xb2c71d5bca9023f8, 0x743e20e9ef511012, 0xdf78e4b2bd342cf6, 0x914da9246b255416,
+        0x8bab8eefb6409c1a, 0x1ad089b6c2f7548e, 0xae9672aba3d0c320, 0xa184ac2473b529b1,
+        0xda3c0f568cc4f3e8, 0xc9e5d72d90a2741e, 0x8865899617fb1871, 0x7e2fa67c7a658892,
+        0xaa7eebfb9df9de8d, 0xddbb901b98feeab7, 0xd51ea6fa85785631, 0x552a74227f3ea565,
+        0x8533285c936b35de, 0xd53a88958f87275f, 0xa67ff273b8460356, 0x8a892abaf368f137,
+        0xd01fef10a657842c, 0x2d2b7569b0432d85, 0x8213f56a67f6b29b, 0x9c3b29620e29fc73,
+        0xa298f2c501f45f42, 0x8349f3ba91b47b8f, 0xcb3f2f7642717713, 0x241c70a936219a73,
+        0xfe0efb53d30dd4d7, 0xed238cd383aa0110, 0x9ec95d1463e8a506, 0xf4363804324a40aa,
+        0xc67bb4597ce2ce48, 0xb143c6053edcd0d5, 0xf81aa16fdc1b81da, 0xdd94b7868e94050a,
+        0x9b10a4e5e9913128, 0xca7cf2b4191c8326, 0xc1d4ce1f63f57d72, 0xfd1c2f611f63a3f0,
+        0xf24a01a73cf2dccf, 0xbc633b39673c8cec, 0x976e41088617ca01, 0xd5be0503e085d813,
+        0xbd49d14aa79dbc82, 0x4b2d8644d8a74e18, 0xec9c459d51852ba2, 0xddf8e7d60ed1219e,
+        0x93e1ab8252f33b45, 0xcabb90e5c942b503, 0xb8da1662e7b00a17, 0x3d6a751f3b936243,
+        0xe7109bfba19c0c9d, 0x0cc512670a783ad4, 0x906a617d450187e2, 0x27fb2b80668b24c5,
+        0xb484f9dc9641e9da, 0xb1f9f660802dedf6, 0xe1a63853bbd26451, 0x5e7873f8a0396973,
+        0x8d07e33455637eb2, 0xdb0b487b6423e1e8, 0xb049dc016abc5e5f, 0x91ce1a9a3d2cda62,
+        0xdc5c5301c56b75f7, 0x7641a140cc7810fb, 0x89b9b3e11b6329ba, 0xa9e904c87fcb0a9d,
+        0xac2820d9623bf429, 0x546345fa9fbdcd44, 0xd732290fbacaf133, 0xa97c177947ad4095,
+        0x867f59a9d4bed6c0, 0x49ed8eabcccc485d, 0xa81f301449ee8c70, 0x5c68f256bfff5a74,
+        0xd226fc195c6a2f8c, 0x73832eec6fff3111, 0x83585d8fd9c25db7, 0xc831fd53c5ff7eab,
+        0xa42e74f3d032f525, 0xba3e7ca8b77f5e55, 0xcd3a1230c43fb26f, 0x28ce1bd2e55f35eb,
+        0x80444b5e7aa7cf85, 0x7980d163cf5b81b3, 0xa0555e361951c366, 0xd7e105bcc332621f,
+        0xc86ab5c39fa63440, 0x8dd9472bf3fefaa7, 0xfa856334878fc150, 0xb14f98f6f0feb951,
+        0x9c935e00d4b9d8d2, 0x6ed1bf9a569f33d3, 0xc3b8358109e84f07, 0x0a862f80ec4700c8,
+        0xf4a642e14c6262c8, 0xcd27bb612758c0fa, 0x98e7e9cccfbd7dbd, 0x8038d51cb897789c,
+        0xbf21e44003acdd2c, 0xe0470a63e6bd56c3, 0xeeea5d5004981478, 0x1858ccfce06cac74,
+        0x95527a5202df0ccb, 0x0f37801e0c43ebc8, 0xbaa718e68396cffd, 0xd30560258f54e6ba,
+        0xe950df20247c83fd, 0x47c6b82ef32a2069, 0x91d28b7416cdd27e, 0x4cdc331d57fa5441,
+        0xb6472e511c81471d, 0xe0133fe4adf8e952, 0xe3d8f9e563a198e5, 0x58180fddd97723a6,
+        0x8e679c2f5e44ff8f, 0x570f09eaa7ea7648
+    };
 
-std::string JsonScanner::TokenName(Token token)
+    // correctly rounded and locale independent, only reached by numbers the fast paths can not decide
+    double ParseDoubleFallback(const char* str, std::size_t length)
+    {
+        std::istringstream stream(std::string(str, length));
+        stream.imbue(std::locale::classic());
+        double value = 0;
+        stream >> value;
+        return value;
+    }
+
+    inline uint64_t PrefixXor(uint64_t value)
+    {
+        value ^= value << 1;
+        value ^= value << 2;
+        value ^= value << 4;
+        value ^= value << 8;
+        value ^= value << 16;
+        value ^= value << 32;
+        return value;
+    }
+}
+
+void util::BuildStructuralIndex(const char* data, std::size_t length, std::vector<uint32_t>& structurals)
 {
-    switch (token) {
-        case Token::WHITESPACE:     return "WHITESPACE";
-        case Token::NUMBER:         return "NUMBER";
-        case Token::STRING:         return "STRING";
-        case Token::LITERAL_TRUE:   return "LITERAL_TRUE";
-        case Token::LITERAL_FALSE:  return "LITERAL_FALSE";
-        case Token::LITERAL_NULL:   return "LITERAL_NULL";
-        case Token::COMMA:          return "COMMA";
-        case Token::COLON:          return "COLON";
-        case Token::ARRAY_BEGIN:    return "ARRAY_BEGIN";
-        case Token::ARRAY_END:      return "ARRAY_END";
-        case Token::OBJECT_BEGIN:   return "OBJECT_BEGIN";
-        case Token::OBJECT_END:     return "OBJECT_END";
-        case Token::EOF_TOKEN:      return "EOF_TOKEN";
+    static const ClassifyBlockFunc classifyBlock = SelectClassifyBlock();
+    structurals.clear();
+    structurals.reserve(length / 4 + 1);
+    uint64_t escapedCarry = 0; // first char of this block is escaped by the previous block
+    uint64_t inStringCarry = 0; // all ones when the previous block ended inside a string
+    uint64_t separatorCarry = 1; // previous char was whitespace or an operator, the input start counts as one
+    char tail[64];
+    for (std::size_t base = 0; base < length; base += 64) {
+        const char* block = data + base;
+        if (length - base < 64) {
+            // pad the last block with whitespace
+            std::memset(tail, ' ', sizeof(tail));
+            std::memcpy(tail, block, length - base);
+            block = tail;
+        }
+        BlockMasks masks {};
+        classifyBlock(block, masks);
+
+        // a backslash escapes the next char, unless it is itself escaped
+        uint64_t escaped = escapedCarry;
+        uint64_t backslash = masks.backslash & ~escapedCarry;
+        escapedCarry = 0;
+        while (backslash != 0) {
+            int i = CountTrailingZeros(backslash);
+            backslash &= backslash - 1;
+            if (i == 63) {
+                escapedCarry = 1;
+            } else {
+                uint64_t next = static_cast<uint64_t>(1) << (i + 1);
+                escaped |= next;
+                backslash &= ~next;
+            }
+        }
+
+        uint64_t quote = masks.quote & ~escaped;
+        // bits from an opening quote (included) to its closing quote (excluded)
+        uint64_t inString = PrefixXor(quote) ^ inStringCarry;
+        inStringCarry = static_cast<uint64_t>(0) - (inString >> 63);
+
+        uint64_t separator = masks.whitespace | masks.op;
+        uint64_t followsSeparator = (separator << 1) | separatorCarry;
+        separatorCarry = separator >> 63;
+        uint64_t scalar = ~(separator | masks.quote) & ~inString;
+
+        uint64_t structural = (masks.op & ~inString) | (quote & inString) | (scalar & followsSeparator);
+        if (length - base < 64) {
+            structural &= (static_cast<uint64_t>(1) << (length - base)) - 1;
+        }
+        while (structural != 0) {
+            structurals.push_back(static_cast<uint32_t>(base + CountTrailingZeros(structural)));
+            structural &= structural - 1;
+        }
     }
-    Panic("Unexpected token");
-    return "";
 }
 
+std::string util::EscapeString(const std::string& str)
+{
+    std::string res;
+    AppendEscapedString(res, str.c_str(), str.length());
+    return res;
+}
 
+void util::AppendEscapedString(std::string& out, const char* str, std::size_t length)
+{
+    std::size_t runBegin = 0;
+    for (std::size_t i = 0; i < length; ++i) {
+        char escaped = 0;
+        switch (str[i]) {
+            case '"': escaped = '"'; break;
+            case '\\': escaped = '\\'; break;
+            case '/': escaped = '/'; break;
+            case '\f': escaped = 'f'; break;
+            case '\b': escaped = 'b'; break;
+            case '\r': escaped = 'r'; break;
+            case '\n': escaped = 'n'; break;
+            case '\t': escaped = 't'; break;
+            default: break;
+        }
+        if (escaped == 0) {
+            continue;
+        }
+        // copy the run of plain chars at once
+        out.append(str + runBegin, i - runBegin);
+        out.push_back('\\');
+        out.push_back(escaped);
+        runBegin = i + 1;
+    }
+    out.append(str + runBegin, length - runBegin);
+}
 
-JsonParser::JsonParser(const std::string& str) 
+std::size_t util::SkipWhitespace(const char* data, std::size_t pos, std::size_t length)
 {
-    m_scanner = new JsonScanner(str);
+    while (pos < length && (data[pos] == ' ' || data[pos] == '\n' || data[pos] == '\r' || data[pos] == '\t')) {
+        pos++;
+    }
+    return pos;
 }
 
-JsonParser::~JsonParser()
+std::size_t util::SkipValue(const char* data, std::size_t pos, std::size_t length)
 {
-    if (m_scanner != nullptr) {
-        delete m_scanner;
-        m_scanner = nullptr;
+    if (pos >= length) {
+        Panic("unexpected end of json value, position: %lu", pos);
+    }
+    std::size_t depth = 0;
+    std::size_t beginPos = pos;
+    switch (data[pos]) {
+        case '{':
+        case '[': {
+            // only quotes and brackets matter, everything in between is skipped undecoded
+            while (pos < length) {
+                char ch = data[pos];
+                if (ch == '\"') {
+                    pos = SkipValue(data, pos, length);
+                    continue;
+                }
+                if (ch == '{' || ch == '[') {
+                    depth++;
+                } else if ((ch == '}' || ch == ']') && --depth == 0) {
+                    return pos + 1;
+                }
+                pos++;
+            }
+            Panic("missing end of json container, position: %lu", beginPos);
+            break;
+        }
+        case '\"': {
+            for (pos++; ; pos += 2) {
+                pos = FindQuoteOrBackslash(data, pos, length);
+                if (pos >= length) {
+                    Panic("missing end of string, position: %lu", beginPos);
+                }
+                if (data[pos] == '\"') {
+                    return pos + 1;
+                }
+            }
+        }
+        default: {
+            // number or literal, ends at the next delimiter
+            while (pos < length) {
+                char ch = data[pos];
+                if (ch == ',' || ch == ':' || ch == ']' || ch == '}' || ch == '[' || ch == '{' || ch == '\"'
+                    || ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t') {
+                    break;
+                }
+                pos++;
+            }
+            if (pos == beginPos) {
+                Panic("Invalid token at position %lu", pos);
+            }
+        }
     }
+    return pos;
 }
 
-JsonElement JsonParser::Parse()
+std::size_t util::FindQuoteOrBackslash(const char* data, std::size_t pos, std::size_t length)
 {
-    m_scanner->Reset();
-    JsonElement ele = ParseNext();
-    if (m_scanner->Next() != JsonScanner::Token::EOF_TOKEN) {
-        Panic("json scanner reached non-eof token, position = %lu", m_scanner->Position());
+#ifdef MINIJSON_X86_SIMD
+    const __m128i quote = _mm_set1_epi8('\"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    while (pos + 16 <= length) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+        if (mask != 0) {
+            return pos + CountTrailingZeros(static_cast<uint64_t>(mask));
+        }
+        pos += 16;
     }
-    return ele;
+#endif
+    while (pos < length && data[pos] != '\"' && data[pos] != '\\') {
+        pos++;
+    }
+    return pos;
 }
 
-bool JsonParser::IsValid()
+void util::AppendUtf8(std::string& str, uint32_t codePoint)
 {
-    try {
-        Parse();
-    } catch (...) {
-        return false;
+    if (codePoint < 0x80) {
+        str.push_back(static_cast<char>(codePoint));
+    } else if (codePoint < 0x800) {
+        str.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+        str.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+    } else if (codePoint < 0x10000) {
+        str.push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+        str.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+        str.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+    } else {
+        str.push_back(static_cast<char>(0xF0 | (codePoint >> 18)));
+        str.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+        str.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+        str.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
     }
-    return true;
 }
 
-JsonElement JsonParser::ParseNext()
+bool util::ScanNumber(const char* data, std::size_t length, std::size_t& pos,
+    bool& isLongInt, int64_t& longValue, double& doubleValue)
 {
-    JsonScanner::Token token = m_scanner->Next();
-    switch (token) {
-        case JsonScanner::Token::OBJECT_BEGIN: {
-            return ParseJsonObject();
+    // example: "-114.51E-4", the first 19 significant digits are kept in mantissa
+    const int MAX_MANTISSA_DIGITS = 19;
+    std::size_t beginPos = pos;
+    bool negative = false;
+    if (pos < length && data[pos] == '-') {
+        negative = true;
+        pos++;
+    }
+    if (pos >= length || !IsDigitChar(data[pos])) {
+        return false;
+    }
+    uint64_t mantissa = 0;
+    int mantissaDigits = 0;
+    int64_t exponent10 = 0;
+    bool truncated = false; // non zero digits did not fit in mantissa
+    bool isInteger = true;
+    for (; pos < length && IsDigitChar(data[pos]); ++pos) {
+        uint64_t digit = static_cast<uint64_t>(data[pos] - '0');
+        if (mantissaDigits < MAX_MANTISSA_DIGITS) {
+            mantissa = mantissa * 10 + digit;
+            mantissaDigits += (mantissa != 0) ? 1 : 0;
+        } else {
+            exponent10++;
+            truncated = truncated || digit != 0;
         }
-        case JsonScanner::Token::ARRAY_BEGIN: {
-            return ParseJsonArray();
+    }
+    if (pos + 1 < length && data[pos] == '.' && IsDigitChar(data[pos + 1])) {
+        isInteger = false;
+        for (pos++; pos < length && IsDigitChar(data[pos]); ++pos) {
+            uint64_t digit = static_cast<uint64_t>(data[pos] - '0');
+            if (mantissaDigits < MAX_MANTISSA_DIGITS) {
+                mantissa = mantissa * 10 + digit;
+                mantissaDigits += (mantissa != 0) ? 1 : 0;
+                exponent10--;
+            } else {
+                truncated = truncated || digit != 0;
+            }
         }
-        case JsonScanner::Token::STRING: {
-            return JsonElement(m_scanner->GetStringValue());
+    }
+    if (pos < length && (data[pos] == 'e' || data[pos] == 'E')) {
+        isInteger = false;
+        pos++;
+        bool negativeExponent = false;
+        if (pos < length && (data[pos] == '-' || data[pos] == '+')) {
+            negativeExponent = (data[pos] == '-');
+            pos++;
         }
-        case JsonScanner::Token::NUMBER: {
-            return m_scanner->IsNumberLongInt() ? 
-                JsonElement(m_scanner->GetLongIntValue()) : JsonElement(m_scanner->GetDoubleValue());
+        if (pos >= length || !IsDigitChar(data[pos])) {
+            return false;
         }
-        case JsonScanner::Token::LITERAL_TRUE: {
-            return JsonElement(true);
+        int64_t exponent = 0;
+        for (; pos < length && IsDigitChar(data[pos]); ++pos) {
+            // saturate, anything beyond is zero or infinity anyway
+            if (exponent < 100000) {
+                exponent = exponent * 10 + (data[pos] - '0');
+            }
         }
-        case JsonScanner::Token::LITERAL_FALSE: {
-            return JsonElement(false);
+        exponent10 += negativeExponent ? -exponent : exponent;
+    }
+
+    const uint64_t INT64_MAX_MAGNITUDE = static_cast<uint64_t>(INT64_MAX);
+    if (isInteger && exponent10 == 0 && mantissa <= INT64_MAX_MAGNITUDE + (negative ? 1 : 0)) {
+        isLongInt = true;
+        longValue = negative ? static_cast<int64_t>(0 - mantissa) : static_cast<int64_t>(mantissa);
+        return true;
+    }
+    // floats and integers overflowing int64
+    isLongInt = false;
+    bool decided = DecimalToDouble(mantissa, exponent10, negative, doubleValue);
+    if (decided && truncated) {
+        // the dropped digits only matter if they can move the result to the next double
+        double upper = 0;
+        decided = DecimalToDouble(mantissa + 1, exponent10, negative, upper) && upper == doubleValue;
+    }
+    if (!decided) {
+        doubleValue = ParseDoubleFallback(data + beginPos, pos - beginPos);
+    }
+    return true;
+}
+
+bool util::DecimalToDouble(uint64_t mantissa, int64_t exponent10, bool negative, double& value)
+{
+    if (mantissa == 0 || exponent10 < SMALLEST_POWER_OF_FIVE) {
+        value = negative ? -0.0 : 0.0;
+        return true;
+    }
+    if (exponent10 > LARGEST_POWER_OF_FIVE) {
+        value = negative ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::infinity();
+        return true;
+    }
+    // Clinger: both mantissa and the power of ten are exact doubles, one rounding only
+    if (-22 <= exponent10 && exponent10 <= 22 && mantissa <= (static_cast<uint64_t>(1) << 53)) {
+        double result = static_cast<double>(mantissa);
+        result = exponent10 < 0 ? result / EXACT_POWER_OF_TEN[-exponent10] : result * EXACT_POWER_OF_TEN[exponent10];
+        value = negative ? -result : result;
+        return true;
+    }
+    // Eisel-Lemire: multiply the normalized mantissa by the 128 bits approximation of 5^exponent10
+    int leadingZeros = CountLeadingZeros(mantissa);
+    uint64_t normalized = mantissa << leadingZeros;
+    std::size_t index = static_cast<std::size_t>(2 * (exponent10 - SMALLEST_POWER_OF_FIVE));
+    uint64_t high = 0;
+    uint64_t low = 0;
+    FullMultiplication(normalized, POWER_OF_FIVE_128[index], high, low);
+    if ((high & 0x1FF) == 0x1FF) {
+        // the truncated bits may carry into the result, refine with the lower word of the power
+        uint64_t secondHigh = 0;
+        uint64_t secondLow = 0;
+        FullMultiplication(normalized, POWER_OF_FIVE_128[index + 1], secondHigh, secondLow);
+        low += secondHigh;
+        if (secondHigh > low) {
+            high++;
         }
-        case JsonScanner::Token::LITERAL_NULL: {
-            return JsonElement();
+        if (low == UINT64_MAX && (exponent10 < -27 || exponent10 > 55)) {
+            return false;
         }
-        case JsonScanner::Token::WHITESPACE:
-        case JsonScanner::Token::COMMA:
-        case JsonScanner::Token::COLON:
-        case JsonScanner::Token::ARRAY_END:
-        case JsonScanner::Token::OBJECT_END:
-        case JsonScanner::Token::EOF_TOKEN:
-        default : Panic("scanner return unexpected token: %s", JsonScanner::TokenName(token).c_str());
     }
-    return JsonElement();
+    int upperBit = static_cast<int>(high >> 63);
+    int shift = upperBit + 64 - 52 - 3;
+    uint64_t bits = high >> shift;
+    int64_t power2 = (((152170 + 65536) * exponent10) >> 16) + 63 + upperBit - leadingZeros + 1023;
+    if (power2 <= 0) {
+        // subnormal
+        return false;
+    }
+    if (low <= 1 && exponent10 >= -4 && exponent10 <= 23 && (bits & 3) == 1 && (bits << shift) == high) {
+        // exactly halfway, round to even instead of up
+        bits &= ~static_cast<uint64_t>(1);
+    }
+    bits += bits & 1;
+    bits >>= 1;
+    if (bits >= (static_cast<uint64_t>(2) << 52)) {
+        bits = static_cast<uint64_t>(1) << 52;
+        power2++;
+    }
+    bits &= ~(static_cast<uint64_t>(1) << 52);
+    if (power2 >= 0x7FF) {
+        value = negative ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::infinity();
+        return true;
+    }
+    bits |= static_cast<uint64_t>(power2) << 52;
+    bits |= negative ? (static_cast<uint64_t>(1) << 63) : 0;
+    std::memcpy(&value, &bits, sizeof(value));
+    return true;
 }
 
-JsonObject JsonParser::ParseJsonObject()
-{
-    JsonObject object {};
-    JsonScanner::Token token = m_scanner->Next();
-    if (token == JsonScanner::Token::OBJECT_END) {
-        return object;
+namespace {
+    // floating point number f * 2^e without the implicit bit, used by Grisu2
+    struct DiyFp {
+        uint64_t f;
+        int e;
+    };
+
+    inline DiyFp DiyFpSub(const DiyFp& x, const DiyFp& y)
+    {
+        return DiyFp { x.f - y.f, x.e };
     }
-    m_scanner->RollBack();
 
-    while (true) {
-        size_t pos = m_scanner->Position();
-        token = m_scanner->Next();
-        if (token != JsonScanner::Token::STRING) {
-            Panic("expect a string as key for json object, position: %lu", pos);
+    // upper 64 bits of the product, rounded
+    inline DiyFp DiyFpMul(const DiyFp& x, const DiyFp& y)
+    {
+        uint64_t high = 0;
+        uint64_t low = 0;
+        FullMultiplication(x.f, y.f, high, low);
+        return DiyFp { high + (low >> 63), x.e + y.e + 64 };
+    }
+
+    inline DiyFp DiyFpNormalize(DiyFp x)
+    {
+        int shift = CountLeadingZeros(x.f);
+        return DiyFp { x.f << shift, x.e - shift };
+    }
+
+    struct CachedPower {
+        uint64_t f;
+        int e;
+        int k;
+    };
+
+    // normalized 10^k for k = -300, -292, ..., 324
+    const CachedPower CACHED_POWERS[] = {
+        { 0xAB70FE17C79AC6CA, -1060, -300 },
+        { 0xFF77B1FCBEBCDC4F, -1034, -292 },
+        { 0xBE5691EF416BD60C, -1007, -284 },
+        { 0x8DD01FAD907FFC3C,  -980, -276 },
+        { 0xD3515C2831559A83,  -954, -268 },
+        { 0x9D71AC8FADA6C9B5,  -927, -260 },
+        { 0xEA9C227723EE8BCB,  -901, -252 },
+        { 0xAECC49914078536D,  -874, -244 },
+        { 0x823C12795DB6CE57,  -847, -236 },
+        { 0xC21094364DFB5637,  -821, -228 },
+        { 0x9096EA6F3848984F,  -794, -220 },
+        { 0xD77485CB25823AC7,  -768, -212 },
+        { 0xA086CFCD97BF97F4,  -741, -204 },
+        { 0xEF340A98172AACE5,  -715, -196 },
+        { 0xB23867FB2A35B28E,  -688, -188 },
+        { 0x84C8D4DFD2C63F3B,  -661, -180 },
+        { 0xC5DD44271AD3CDBA,  -635, -172 },
+        { 0x936B9FCEBB25C996,  -608, -164 },
+        { 0xDBAC6C247D62A584,  -582, -156 },
+        { 0xA3AB66580D5FDAF6,  -555, -148 },
+        { 0xF3E2F893DEC3F126,  -529, -140 },
+        { 0xB5B5ADA8AAFF80B8,  -502, -132 },
+        { 0x87625F056C7C4A8B,  -475, -124 },
+        { 0xC9BCFF6034C13053,  -449, -116 },
+        { 0x964E858C91BA2655,  -422, -108 },
+        { 0xDFF9772470297EBD,  -396, -100 },
+        { 0xA6DFBD9FB8E5B88F,  -369,  -92 },
+        { 0xF8A95FCF88747D94,  -343,  -84 },
+        { 0xB94470938FA89BCF,  -316,  -76 },
+        { 0x8A08F0F8BF0F156B,  -289,  -68 },
+        { 0xCDB02555653131B6,  -263,  -60 },
+        { 0x993FE2C6D07B7FAC,  -236,  -52 },
+        { 0xE45C10C42A2B3B06,  -210,  -44 },
+        { 0xAA242499697392D3,  -183,  -36 },
+        { 0xFD87B5F28300CA0E,  -157,  -28 },
+        { 0xBCE5086492111AEB,  -130,  -20 },
+        { 0x8CBCCC096F5088CC,  -103,  -12 },
+        { 0xD1B71758E219652C,   -77,   -4 },
+        { 0x9C40000000000000,   -50,    4 },
+        { 0xE8D4A51000000000,   -24,   12 },
+        { 0xAD78EBC5AC620000,     3,   20 },
+        { 0x813F3978F8940984,    30,   28 },
+        { 0xC097CE7BC90715B3,    56,   36 },
+        { 0x8F7E32CE7BEA5C70,    83,   44 },
+        { 0xD5D238A4ABE98068,   109,   52 },
+        { 0x9F4F2726179A2245,   136,   60 },
+        { 0xED63A231D4C4FB27,   162,   68 },
+        { 0xB0DE65388CC8ADA8,   189,   76 },
+        { 0x83C7088E1AAB65DB,   216,   84 },
+        { 0xC45D1DF942711D9A,   242,   92 },
+        { 0x924D692CA61BE758,   269,  100 },
+        { 0xDA01EE641A708DEA,   295,  108 },
+        { 0xA26DA3999AEF774A,   322,  116 },
+        { 0xF209787BB47D6B85,   348,  124 },
+        { 0xB454E4A179DD1877,   375,  132 },
+        { 0x865B86925B9BC5C2,   402,  140 },
+        { 0xC83553C5C8965D3D,   428,  148 },
+        { 0x952AB45CFA97A0B3,   455,  156 },
+        { 0xDE469FBD99A05FE3,   481,  164 },
+        { 0xA59BC234DB398C25,   508,  172 },
+        { 0xF6C69A72A3989F5C,   534,  180 },
+        { 0xB7DCBF5354E9BECE,   561,  188 },
+        { 0x88FCF317F22241E2,   588,  196 },
+        { 0xCC20CE9BD35C78A5,   614,  204 },
+        { 0x98165AF37B2153DF,   641,  212 },
+        { 0xE2A0B5DC971F303A,   667,  220 },
+        { 0xA8D9D1535CE3B396,   694,  228 },
+        { 0xFB9B7CD9A4A7443C,   720,  236 },
+        { 0xBB764C4CA7A44410,   747,  244 },
+        { 0x8BAB8EEFB6409C1A,   774,  252 },
+        { 0xD01FEF10A657842C,   800,  260 },
+        { 0x9B10A4E5E9913129,   827,  268 },
+        { 0xE7109BFBA19C0C9D,   853,  276 },
+        { 0xAC2820D9623BF429,   880,  284 },
+        { 0x80444B5E7AA7CF85,   907,  292 },
+        { 0xBF21E44003ACDD2D,   933,  300 },
+        { 0x8E679C2F5E44FF8F,   960,  308 },
+        { 0xD433179D9C8CB841,   986,  316 },
+        { 0x9E19DB92B4E31BA9,  1013,  324 }
+    };
+
+    const int CACHED_POWERS_MIN_DECIMAL_EXPONENT = -300;
+    const int CACHED_POWERS_DECIMAL_STEP = 8;
+    // the scaled boundaries must have binary exponents in [ALPHA, GAMMA] for the digit generation
+    const int GRISU_ALPHA = -60;
+
+    const char DIGIT_PAIRS[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+    // cached power c = 10^-k such that the exponent of c * 2^e falls in [ALPHA, GAMMA]
+    const CachedPower& CachedPowerForBinaryExponent(int e)
+    {
+        int f = GRISU_ALPHA - e - 1;
+        int k = (f * 78913) / (1 << 18) + (f > 0 ? 1 : 0); // ceil(f * log10(2))
+        int index = (-CACHED_POWERS_MIN_DECIMAL_EXPONENT + k + (CACHED_POWERS_DECIMAL_STEP - 1))
+            / CACHED_POWERS_DECIMAL_STEP;
+        return CACHED_POWERS[index];
+    }
+
+    // number of decimal digits of n, pow10 is set to 10^(digits - 1)
+    int FindLargestPow10(uint32_t n, uint32_t& pow10)
+    {
+        const uint32_t POWERS[] = {
+            1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+        };
+        int digits = 10;
+        while (digits > 1 && n < POWERS[digits - 1]) {
+            digits--;
         }
-        std::string key = m_scanner->GetStringValue();
+        pow10 = POWERS[digits - 1];
+        return digits;
+    }
 
-        pos = m_scanner->Position();
-        token = m_scanner->Next();
-        if (token != JsonScanner::Token::COLON) {
-            Panic("expect ':' in json object, position: %lu", pos);
+    // move the last digit towards w while it stays inside the boundaries
+    void Grisu2Round(char* buffer, int length, uint64_t distance, uint64_t delta, uint64_t rest, uint64_t tenK)
+    {
+        while (rest < distance && delta - rest >= tenK
+            && (rest + tenK < distance || distance - rest > rest + tenK - distance)) {
+            buffer[length - 1]--;
+            rest += tenK;
         }
-        JsonElement ele = ParseNext();
-        object[key] = ele;
+    }
 
-        pos = m_scanner->Position();
-        token = m_scanner->Next();
-        if (token == JsonScanner::Token::OBJECT_END) {
-            break;
+    void Grisu2DigitGen(char* buffer, int& length, int& decimalExponent, DiyFp minus, DiyFp w, DiyFp plus)
+    {
+        uint64_t delta = DiyFpSub(plus, minus).f;
+        uint64_t distance = DiyFpSub(plus, w).f;
+        const DiyFp one { static_cast<uint64_t>(1) << -plus.e, plus.e };
+        uint32_t integral = static_cast<uint32_t>(plus.f >> -one.e);
+        uint64_t fractional = plus.f & (one.f - 1);
+
+        uint32_t pow10 = 0;
+        int n = FindLargestPow10(integral, pow10);
+        while (n > 0) {
+            buffer[length++] = static_cast<char>('0' + integral / pow10);
+            integral %= pow10;
+            n--;
+            uint64_t rest = (static_cast<uint64_t>(integral) << -one.e) + fractional;
+            if (rest <= delta) {
+                decimalExponent += n;
+                Grisu2Round(buffer, length, distance, delta, rest, static_cast<uint64_t>(pow10) << -one.e);
+                return;
+            }
+            pow10 /= 10;
         }
-        if (token != JsonScanner::Token::COMMA) {
-            Panic("expect ',' in json object, position: %lu", pos);
+        int m = 0;
+        while (true) {
+            fractional *= 10;
+            buffer[length++] = static_cast<char>('0' + (fractional >> -one.e));
+            fractional &= one.f - 1;
+            m++;
+            delta *= 10;
+            distance *= 10;
+            if (fractional <= delta) {
+                break;
+            }
         }
+        decimalExponent -= m;
+        Grisu2Round(buffer, length, distance, delta, fractional, one.f);
     }
-    return object;
-}
 
-JsonArray JsonParser::ParseJsonArray()
-{
-    JsonArray array {};
-    JsonScanner::Token token = m_scanner->Next();
-    if (token == JsonScanner::Token::ARRAY_END) {
-        return array;
+    // shortest digits of a positive finite value, value = digits * 10^decimalExponent
+    void Grisu2(double value, char* buffer, int& length, int& decimalExponent)
+    {
+        const uint64_t HIDDEN_BIT = static_cast<uint64_t>(1) << 52;
+        const int EXPONENT_BIAS = 1075;
+        uint64_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(bits));
+        uint64_t significand = bits & (HIDDEN_BIT - 1);
+        int biasedExponent = static_cast<int>(bits >> 52);
+        DiyFp v = biasedExponent == 0
+            ? DiyFp { significand, 1 - EXPONENT_BIAS }
+            : DiyFp { significand + HIDDEN_BIT, biasedExponent - EXPONENT_BIAS };
+        // boundaries m- and m+ of the rounding interval, the lower gap is half as large at a power of two
+        bool lowerBoundaryIsCloser = significand == 0 && biasedExponent > 1;
+        DiyFp plus = DiyFpNormalize(DiyFp { 2 * v.f + 1, v.e - 1 });
+        DiyFp minus = lowerBoundaryIsCloser ? DiyFp { 4 * v.f - 1, v.e - 2 } : DiyFp { 2 * v.f - 1, v.e - 1 };
+        minus = DiyFp { minus.f << (minus.e - plus.e), plus.e };
+        v = DiyFpNormalize(v);
+
+        const CachedPower& cached = CachedPowerForBinaryExponent(plus.e);
+        const DiyFp c { cached.f, cached.e };
+        DiyFp w = DiyFpMul(v, c);
+        DiyFp wMinus = DiyFpMul(minus, c);
+        DiyFp wPlus = DiyFpMul(plus, c);
+        // shrink the interval by one ulp on both sides to stay safe from the multiplication error
+        wMinus.f++;
+        wPlus.f--;
+        length = 0;
+        decimalExponent = -cached.k;
+        Grisu2DigitGen(buffer, length, decimalExponent, wMinus, w, wPlus);
     }
-    m_scanner->RollBack();
 
-    while (true) {
-        array.push_back(ParseNext());
-        size_t pos = m_scanner->Position();
-        token = m_scanner->Next();
-        if (token == JsonScanner::Token::ARRAY_END) {
-            break;
+    char* WriteExponent(char* buffer, int exponent)
+    {
+        *buffer++ = 'e';
+        *buffer++ = exponent < 0 ? '-' : '+';
+        uint32_t magnitude = static_cast<uint32_t>(exponent < 0 ? -exponent : exponent);
+        if (magnitude >= 100) {
+            *buffer++ = static_cast<char>('0' + magnitude / 100);
+            magnitude %= 100;
+            std::memcpy(buffer, DIGIT_PAIRS + magnitude * 2, 2);
+            return buffer + 2;
         }
-        if (token != JsonScanner::Token::COMMA) {
-            Panic("expect ',' in array, pos: %lu", pos);
+        if (magnitude >= 10) {
+            std::memcpy(buffer, DIGIT_PAIRS + magnitude * 2, 2);
+            return buffer + 2;
         }
+        *buffer++ = static_cast<char>('0' + magnitude);
+        return buffer;
+    }
+
+    // place the decimal point in digits[0, length) where value = digits * 10^exponent
+    std::size_t FormatDecimal(char* buffer, int length, int exponent)
+    {
+        const int MAX_FIXED_DIGITS = 21;
+        int point = length + exponent; // position of the decimal point relative to the first digit
+        if (length <= point && point <= MAX_FIXED_DIGITS) {
+            // integral, 123e2 -> 12300
+            std::memset(buffer + length, '0', static_cast<std::size_t>(point - length));
+            return static_cast<std::size_t>(point);
+        }
+        if (0 < point && point <= MAX_FIXED_DIGITS) {
+            // 1234e-2 -> 12.34
+            std::memmove(buffer + point + 1, buffer + point, static_cast<std::size_t>(length - point));
+            buffer[point] = '.';
+            return static_cast<std::size_t>(length + 1);
+        }
+        if (-6 < point && point <= 0) {
+            // 1234e-6 -> 0.001234
+            std::size_t zeros = static_cast<std::size_t>(-point);
+            std::memmove(buffer + 2 + zeros, buffer, static_cast<std::size_t>(length));
+            buffer[0] = '0';
+            buffer[1] = '.';
+            std::memset(buffer + 2, '0', zeros);
+            return 2 + zeros + static_cast<std::size_t>(length);
+        }
+        // scientific, 1234e-12 -> 1.234e-9, 1e30 -> 1e+30
+        char* end = buffer + 1;
+        if (length > 1) {
+            std::memmove(buffer + 2, buffer + 1, static_cast<std::size_t>(length - 1));
+            buffer[1] = '.';
+            end = buffer + length + 1;
+        }
+        end = WriteExponent(end, point - 1);
+        return static_cast<std::size_t>(end - buffer);
     }
-    return array;
 }
 
-std::string util::EscapeString(const std::string& str)
+int64_t util::DoubleToLongInt(double value)
 {
-    std::string res;
-    for (const char ch: str) {
-        switch (ch) {
-            case '"':
-            case '\\':
-            case '/':
-                res.push_back('\\');
-                res.push_back(ch);
-                break;
-            case '\f': {
-                res.push_back('\\');
-                res.push_back('f');
-                break;
-            }
-            case '\b': {
-                res.push_back('\\');
-                res.push_back('b');
-                break;
-            }
-            case '\r': {
-                res.push_back('\\');
-                res.push_back('r');
-                break;
-            }
-            case '\n': {
-                res.push_back('\\');
-                res.push_back('n');
-                break;
-            }
-            case '\t': {
-                res.push_back('\\');
-                res.push_back('t');
-                break;
-            }
-            default: {
-                res.push_back(ch);
-                break;
-            }
-        }
+    // -2^63 and 2^63 are exact doubles, NaN fails both comparisons
+    if (!(value >= -9223372036854775808.0 && value < 9223372036854775808.0)) {
+        Panic("double %g is out of the long int range", value);
     }
-    return res;
+    return static_cast<int64_t>(value);
 }
 
-std::string util::UnescapeString(const std::string& str)
+std::size_t util::FormatDouble(double value, char* buffer)
 {
-    std::string res;
-    for (size_t i = 0; i < str.size(); ++i) {
-        char curChar = str[i];
-        if (curChar == '\\' && i + 1 < str.size()) {
-            char escapeChar = str[++i];
-            switch (escapeChar) {
-                case '"':
-                    res.push_back('"');
-                    break;
-                case '\\':
-                    res.push_back('\\');
-                    break;
-                case '/':
-                    res.push_back('/');
-                    break;
-                case 'f': {
-                    res.push_back('\f');
-                    break;
-                }
-                case 'b': {
-                    res.push_back('\b');
-                    break;
-                }
-                case 'r': {
-                    res.push_back('\r');
-                    break;
-                }
-                case 'n': {
-                    res.push_back('\n');
-                    break;
-                }
-                case 't': {
-                    res.push_back('\t');
-                    break;
-                }
-                Panic("invalid escaped char \\%c", escapeChar);
-            }
-        } else {
-            res.push_back(curChar);
-        }
+    if (std::isnan(value) || std::isinf(value)) {
+        std::memcpy(buffer, "null", 4);
+        return 4;
     }
-    return res;
+    char* begin = buffer;
+    if (std::signbit(value)) {
+        *buffer++ = '-';
+        value = -value;
+    }
+    if (value == 0) {
+        *buffer++ = '0';
+        return static_cast<std::size_t>(buffer - begin);
+    }
+    int length = 0;
+    int decimalExponent = 0;
+    Grisu2(value, buffer, length, decimalExponent);
+    return static_cast<std::size_t>(buffer - begin) + FormatDecimal(buffer, length, decimalExponent);
 }
 
-std::string util::DoubleToString(double value)
+std::size_t util::FormatLongInt(int64_t value, char* buffer)
 {
-    std::string res = std::to_string(value);
-    if (res.find('.') != std::string::npos) {
-        while(res.back() == '0') {
-            res.pop_back();
-        }
+    char* begin = buffer;
+    uint64_t magnitude = static_cast<uint64_t>(value);
+    if (value < 0) {
+        *buffer++ = '-';
+        magnitude = 0 - magnitude;
     }
-    if (res.back() == '.') {
-        res.pop_back();
+    // write two digits at a time from the back of a scratch buffer
+    char scratch[20];
+    char* pos = scratch + sizeof(scratch);
+    while (magnitude >= 100) {
+        uint64_t pair = magnitude % 100;
+        magnitude /= 100;
+        pos -= 2;
+        std::memcpy(pos, DIGIT_PAIRS + pair * 2, 2);
     }
-    return res;
+    if (magnitude >= 10) {
+        pos -= 2;
+        std::memcpy(pos, DIGIT_PAIRS + magnitude * 2, 2);
+    } else {
+        *--pos = static_cast<char>('0' + magnitude);
+    }
+    std::size_t digits = static_cast<std::size_t>(scratch + sizeof(scratch) - pos);
+    std::memcpy(buffer, pos, digits);
+    return static_cast<std::size_t>(buffer - begin) + digits;
+}
+
+std::string util::DoubleToString(double value)
+{
+    char buffer[MAX_NUMBER_LENGTH];
+    return std::string(buffer, FormatDouble(value, buffer));
 }
 
 std::string util::LongIntToString(int64_t value)
 {
-    std::string res = std::to_string(value);
-    return res;
+    char buffer[MAX_NUMBER_LENGTH];
+    return std::string(buffer, FormatLongInt(value, buffer));
 }
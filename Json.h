@@ -12,6 +12,8 @@
 #define _XURANUS_MINI_JSON_HEADER_
 
 #include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <iostream>
 #include <stdexcept>
 #include <string>
@@ -54,24 +56,25 @@
     #define MINIJSON_API  __attribute__((__visibility__("default")))
 #endif
 
+// the section body is a template visiting every field, the JsonObject method is kept on top of it
 #define SERIALIZE_SECTION_BEGIN                                                                     \
 public:                                                                                             \
     using __XURANUS_JSON_SERIALIZATION_MAGIC__ = void;                                              \
 public:                                                                                             \
     void _XURANUS_JSON_CPP_SERIALIZE_METHOD_(xuranus::minijson::JsonObject& object, bool toJson)    \
     {                                                                                               \
+        xuranus::minijson::rules::JsonObjectVisitor visitor(object, toJson);                        \
+        _XURANUS_JSON_CPP_VISIT_METHOD_(visitor);                                                   \
+    }                                                                                               \
+    template<typename Visitor>                                                                      \
+    void _XURANUS_JSON_CPP_VISIT_METHOD_(Visitor& visitor)                                          \
+    {                                                                                               \
 
 #define SERIALIZE_SECTION_END                                                                       \
     };                                                                                              \
 
 #define SERIALIZE_FIELD(KEY_NAME, ATTR_NAME)                                                        \
-    do {                                                                                            \
-        if (toJson) {                                                                               \
-            xuranus::minijson::rules::SerializeTo(object, #KEY_NAME, ATTR_NAME);                    \
-        } else {                                                                                    \
-            xuranus::minijson::rules::DeserializeFrom(object, #KEY_NAME, ATTR_NAME);                \
-        }                                                                                           \
-    } while (0)                                                                                     \
+    visitor.Field(#KEY_NAME, ATTR_NAME)                                                             \
 
 namespace xuranus {
 namespace minijson {
@@ -80,6 +83,14 @@ class JsonElement;
 class JsonObject;
 class JsonArray;
 class JsonScanner;
+class JsonArena;
+class JsonKeyPool;
+class JsonDocumentBuilder;
+struct JsonMember;
+class JsonTape;
+class JsonWriter;
+class JsonHandler;
+class JsonElementBuilder;
 
 inline void Panic(const char* str, ...)
 {
@@ -102,10 +113,10 @@ class MINIJSON_API Serializable {
     virtual std::string Serialize() const = 0;
 };
 
-// base class of json variant
-class MINIJSON_API JsonElement: public Serializable {
+// base class of json variant, kept to 16 bytes with no vtable so arrays of scalars stay compact
+class MINIJSON_API JsonElement {
     public:
-        enum class Type {
+        enum class Type : uint8_t {
             JSON_OBJECT,
             JSON_ARRAY,
             JSON_STRING,
@@ -115,6 +126,10 @@ class MINIJSON_API JsonElement: public Serializable {
             JSON_NULL
         };
 
+        // strings up to this length are stored in the element itself instead of a heap std::string
+        static const std::size_t INLINE_STRING_CAPACITY = 14;
+
+        // the payload and the inline string share the first bytes, the tag lives in the last two
         union Value {
             JsonObject* objectValue;
             JsonArray* arrayValue;
@@ -122,6 +137,12 @@ class MINIJSON_API JsonElement: public Serializable {
             int64_t numberLongValue;
             double numberDoubleValue;
             bool boolValue;
+            char inlineString[INLINE_STRING_CAPACITY];
+            struct {
+                char payload[INLINE_STRING_CAPACITY];
+                uint8_t inlineStringLength; // only meaningful for JSON_STRING
+                Type type;
+            } tag;
         };
 
     public:
@@ -131,12 +152,18 @@ class MINIJSON_API JsonElement: public Serializable {
         explicit JsonElement(double num);
         explicit JsonElement(int64_t num);
         explicit JsonElement(const std::string &str);
+        explicit JsonElement(std::string &&str);
         explicit JsonElement(char const *str);
         JsonElement(const JsonObject& object);
+        JsonElement(JsonObject&& object);
         JsonElement(const JsonArray& array);
+        JsonElement(JsonArray&& array);
         JsonElement(const JsonElement& ele);
-        explicit JsonElement(JsonElement&& ele);
+        // a moved-from element is left as JSON_NULL
+        JsonElement(JsonElement&& ele) noexcept;
         JsonElement& operator = (const JsonElement& ele);
+        // the previous value is released right away and ele is left as JSON_NULL
+        JsonElement& operator = (JsonElement&& ele) noexcept;
         ~JsonElement();
 
         bool& AsBool();
@@ -164,16 +191,85 @@ class MINIJSON_API JsonElement: public Serializable {
         bool IsJsonArray() const;
 
         std::string TypeName() const;
-        std::string Serialize() const override;
+        std::string Serialize() const;
 
     private:
-        Type m_type = Type::JSON_NULL;
+        friend class JsonWriter;
+        void SetString(const char* str, std::size_t length);
+        void SetString(std::string&& str);
+        bool IsInlineString() const;
+        const char* StringData() const;
+        std::size_t StringLength() const;
+        void Release();
+
+    private:
+        // an inline string moves to the heap when AsString() hands out a std::string reference
+        static const uint8_t HEAP_STRING = 0xFF;
         Value m_value {};
 };
 
-class MINIJSON_API JsonObject: public std::map<std::string, JsonElement>, public Serializable {
+/*
+ * members are kept in a contiguous vector in insertion order, small objects are searched linearly
+ * and larger ones through an open-addressing index of member positions.
+ * like std::vector, inserting or erasing invalidates iterators and references to members.
+ * unlike std::map the key of value_type is not const, so that growing the vector moves members instead of
+ * deep copying them: values may be written through an iterator, but a key must be renamed with erase and emplace,
+ * changing it in place breaks later lookups.
+ */
+class MINIJSON_API JsonObject: public Serializable {
 public:
+    using key_type = std::string;
+    using mapped_type = JsonElement;
+    using value_type = std::pair<std::string, JsonElement>;
+    using size_type = std::size_t;
+    using iterator = std::vector<value_type>::iterator;
+    using const_iterator = std::vector<value_type>::const_iterator;
+
+    // objects with more members than this are looked up through the hash index
+    static const std::size_t INDEX_THRESHOLD = 8;
+
+    JsonElement& operator [] (const std::string& key);
+    JsonElement& operator [] (std::string&& key);
+    JsonElement& at(const std::string& key);
+    const JsonElement& at(const std::string& key) const;
+
+    iterator find(const std::string& key);
+    const_iterator find(const std::string& key) const;
+    size_type count(const std::string& key) const;
+
+    std::pair<iterator, bool> insert(const value_type& member);
+    std::pair<iterator, bool> insert(value_type&& member);
+    template<typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args)
+    {
+        return insert(value_type(std::forward<Args>(args)...));
+    }
+    iterator erase(const_iterator pos);
+    size_type erase(const std::string& key);
+    void clear();
+    void reserve(size_type count);
+
+    iterator begin() { return m_members.begin(); }
+    iterator end() { return m_members.end(); }
+    const_iterator begin() const { return m_members.begin(); }
+    const_iterator end() const { return m_members.end(); }
+    const_iterator cbegin() const { return m_members.cbegin(); }
+    const_iterator cend() const { return m_members.cend(); }
+    size_type size() const { return m_members.size(); }
+    bool empty() const { return m_members.empty(); }
+
     std::string Serialize() const override;
+
+private:
+    std::size_t FindPosition(const std::string& key) const;
+    JsonElement& Append(std::string&& key);
+    void IndexMember(std::size_t pos);
+    void RebuildIndex();
+
+private:
+    std::vector<value_type> m_members {};
+    // slots hold member position + 1, 0 marks an empty slot. empty until the threshold is crossed
+    std::vector<uint32_t> m_index {};
 };
 
 class MINIJSON_API JsonArray: public std::vector<JsonElement>, public Serializable {
@@ -181,18 +277,603 @@ public:
     std::string Serialize() const override;
 };
 
+/**
+ * JsonWriter appends compact json text to a single growable buffer, commas and key separators are inserted
+ * automatically. The caller must emit a balanced sequence of events, with a Key before each member value.
+ * With an std::ostream sink the buffer is flushed whenever it grows past a threshold, and on destruction.
+ */
+class MINIJSON_API JsonWriter {
+    public:
+        JsonWriter();
+        explicit JsonWriter(std::ostream& sink);
+        JsonWriter(const JsonWriter&) = delete;
+        JsonWriter& operator = (const JsonWriter&) = delete;
+        ~JsonWriter();
+
+        void StartObject();
+        void EndObject();
+        void StartArray();
+        void EndArray();
+        void Key(const std::string& key);
+        void Key(const char* key, std::size_t length);
+        void String(const std::string& str);
+        void String(const char* str, std::size_t length);
+        void Int64(int64_t value);
+        void Double(double value);
+        void Bool(bool value);
+        void Null();
+        // write a whole value, containers are walked in place without copying
+        void Write(const JsonElement& element);
+        void Write(const JsonObject& object);
+        void Write(const JsonArray& array);
+
+        // text written so far and not yet flushed to the sink
+        const std::string& GetString() const;
+        // move the buffered text out and reset the writer, like Clear() it is then ready for a new document
+        std::string TakeString();
+        void Flush();
+        void Clear();
+    private:
+        void BeginValue();
+        void EndValue();
+    private:
+        std::string m_buffer {};
+        std::ostream* m_sink { nullptr };
+        bool m_needComma { false };
+};
+
+/**
+ * JsonHandler receives the events of JsonParser::Parse(JsonHandler&) in document order, no DOM node is built.
+ * String and key data point into a scanner buffer that is only valid during the callback.
+ * Returning false from any callback stops the parse early. Unhandled events are ignored by default.
+ */
+class MINIJSON_API JsonHandler {
+    public:
+        virtual ~JsonHandler();
+        virtual bool StartObject();
+        virtual bool Key(const char* key, std::size_t length);
+        virtual bool EndObject(std::size_t memberCount);
+        virtual bool StartArray();
+        virtual bool EndArray(std::size_t elementCount);
+        virtual bool String(const char* str, std::size_t length);
+        virtual bool Int64(int64_t value);
+        virtual bool Double(double value);
+        virtual bool Bool(bool value);
+        virtual bool Null();
+};
+
+enum class JsonErrorCode {
+    NONE,
+    UNEXPECTED_END, // input ended inside a value
+    INVALID_TOKEN, // a char that starts no token
+    INVALID_LITERAL, // misspelled true, false or null
+    INVALID_NUMBER,
+    INVALID_ESCAPE, // unknown escape, bad \u digits or unpaired surrogate
+    MISSING_QUOTE, // string not closed
+    EXPECT_KEY,
+    EXPECT_COLON,
+    EXPECT_COMMA_OR_END, // ',' or the closing bracket after a member or element
+    EXPECT_VALUE,
+    TRAILING_CONTENT, // more tokens after the root value
+    DEPTH_EXCEEDED // containers nested deeper than JsonParser::MAX_DEPTH
+};
+
+// why and where a document was rejected, offset is the byte position of the offending token
+struct MINIJSON_API JsonError {
+    JsonErrorCode code = JsonErrorCode::NONE;
+    std::size_t offset = 0;
+
+    // static description of the code
+    const char* Reason() const;
+    // 1-based line and column of offset, computed on demand from the input that was parsed
+    void Locate(const char* data, std::size_t& line, std::size_t& column) const;
+};
+
+/**
+ * JsonParser scans its input in place and never copies it.
+ * The buffer passed by pointer/length or by const reference is borrowed: it must stay alive and unmodified
+ * until the parser is destroyed. An rvalue string is moved into the parser, so temporaries are always safe.
+ */
 class MINIJSON_API JsonParser {
     public:
+        // deepest container nesting accepted by Parse() and Validate(), deeper input is rejected before it exhausts the stack
+        static const std::size_t MAX_DEPTH = 1024;
+
         explicit JsonParser(const std::string& str);
+        explicit JsonParser(std::string&& str);
+        JsonParser(const char* data, std::size_t length);
+        JsonParser(const JsonParser&) = delete;
+        JsonParser& operator = (const JsonParser&) = delete;
         ~JsonParser();
+        // memory map the file read-only and parse it in place, falls back to buffered reads for pipes
+        static JsonElement ParseFile(const std::string& path);
+        // optional SIMD (SSE2/AVX2, chosen at runtime) first pass over the input that indexes structural characters,
+        // the token loop then jumps over whitespace runs; tokens themselves are still scanned byte by byte,
+        // so only whitespace heavy (pretty printed) input gets faster, and results are identical to the plain scanner
+        void UseStructuralIndex(bool enable);
         JsonElement Parse();
+        /**
+         * parse a large top level array on threadCount threads (0 for one per hardware thread).
+         * top level commas found by the structural index split it into slices that are parsed concurrently
+         * and moved into one JsonArray. Other documents, small inputs and any error go through Parse(),
+         * so the result and the thrown error are always those of Parse()
+         */
+        JsonElement ParseParallel(std::size_t threadCount = 0);
+        // stream the events to handler, return false if the handler stopped the parse early
+        bool Parse(JsonHandler& handler);
+        // validate without building nodes, allocating or throwing
         bool IsValid();
+        bool Validate(JsonError& error);
+        // parse without throwing on malformed input, element is left untouched on failure
+        bool TryParse(JsonElement& element, JsonError& error);
     private:
         JsonElement ParseNext();
         JsonObject ParseJsonObject();
         JsonArray ParseJsonArray();
+        // comma separated elements of an array without the brackets, used by ParseParallel
+        JsonArray ParseJsonArraySlice();
+        bool ParseNext(JsonHandler& handler);
+        bool ParseJsonObject(JsonHandler& handler);
+        bool ParseJsonArray(JsonHandler& handler);
+        void EnterContainer();
     private:
+        std::string m_buffer {}; // only used when the parser owns its input
         JsonScanner* m_scanner { nullptr };
+        std::size_t m_depth { 0 }; // open containers above the value being parsed
+        // members of the objects being parsed, shared by all nesting levels so each object is allocated at its final size
+        std::vector<std::pair<std::string, JsonElement>> m_members {};
+};
+
+/**
+ * JsonReader pulls values out of the text one at a time without building any node,
+ * util::Deserialize uses it to fill SERIALIZE_SECTION types straight from the tokens.
+ * Every call checks the grammar and throws std::logic_error on malformed input or on a type mismatch.
+ *
+ *   reader.StartObject();
+ *   while (reader.NextMember(key)) {
+ *       // read or skip exactly one value
+ *   }
+ */
+class MINIJSON_API JsonReader {
+    public:
+        // the input is borrowed and must outlive the reader
+        explicit JsonReader(const std::string& str);
+        explicit JsonReader(std::string&& str) = delete;
+        JsonReader(const char* data, std::size_t length);
+        JsonReader(const JsonReader&) = delete;
+        JsonReader& operator = (const JsonReader&) = delete;
+        ~JsonReader();
+
+        // type of the next value without consuming it
+        JsonElement::Type PeekType();
+        void StartObject();
+        // move to the next member and read its key, consume the '}' and return false at the end of the object
+        bool NextMember(std::string& key);
+        void StartArray();
+        // move to the next element, consume the ']' and return false at the end of the array
+        bool NextElement();
+
+        bool ReadBool();
+        // integers and doubles are both accepted, doubles are truncated toward zero
+        int64_t ReadLongInt();
+        double ReadDouble();
+        void ReadString(std::string& str);
+        std::string ReadString();
+        void ReadNull();
+        void SkipValue();
+        // check that nothing but whitespace follows the top level value
+        void Finish();
+
+    private:
+        bool NextInContainer(bool isObject);
+        void EnterContainer();
+    private:
+        JsonScanner* m_scanner { nullptr };
+        bool m_first { false }; // no member or element has been read from the innermost open container
+        std::size_t m_depth { 0 }; // open containers, capped at JsonParser::MAX_DEPTH like the parser
+};
+
+/**
+ * JsonFieldTable maps the keys of a SERIALIZE_SECTION type to field positions in declaration order.
+ * It is built once per type on first use, large tables are hashed and the field after the last match
+ * is tried first, so members arriving in declaration order cost one comparison each.
+ * Each field also records its offset in the object and a reader and writer for its type, so a matched member
+ * is read straight into the field without visiting the others. Fields sharing a key are written once, at the
+ * position of the first one with the value of the last one, which is the text the JsonObject path produces.
+ */
+class MINIJSON_API JsonFieldTable {
+    public:
+        static const std::size_t NO_FIELD = static_cast<std::size_t>(-1);
+        // fields with more keys than this get a hash index
+        static const std::size_t INDEX_THRESHOLD = 8;
+
+        // reads the current value of a JsonReader into the field at the given address
+        using ReadFunc = void (*)(JsonReader& reader, void* field);
+        // writes the value of the field at the given address
+        using WriteFunc = void (*)(JsonWriter& writer, const void* field);
+
+        // key is a string literal of SERIALIZE_FIELD and is not copied, a repeated key only maps to its first field.
+        // read and write are nullptr when the field does not live inside the object, such as a static or reference member
+        void Add(const char* key, ReadFunc read = nullptr, WriteFunc write = nullptr, std::size_t offset = 0);
+        // position of the field named key or NO_FIELD, hint is compared first
+        std::size_t Find(const std::string& key, std::size_t hint) const;
+        // read the current value into the field of object, return false if the field has no reader
+        bool Read(std::size_t field, JsonReader& reader, void* object) const;
+        // whether an earlier field has the same key
+        inline bool IsRepeated(std::size_t field) const { return m_fields[field].key == nullptr; }
+        // write the value of the last field sharing the key of field, return false if field is that last one
+        bool WriteLastRepeat(std::size_t field, JsonWriter& writer, const void* object) const;
+        inline std::size_t Size() const { return m_fields.size(); }
+
+    private:
+        std::size_t Search(const char* key, std::size_t length) const;
+        void RebuildIndex();
+
+    private:
+        struct Entry {
+            const char* key; // nullptr for a repeated key
+            std::size_t length;
+            ReadFunc read;
+            WriteFunc write;
+            std::size_t offset; // of the field from the start of the object
+            std::size_t last; // position of the last field with the same key
+        };
+        std::vector<Entry> m_fields {};
+        std::vector<uint32_t> m_index {}; // open addressing, slots hold field position + 1
+};
+
+/**
+ * JsonPushParser parses a single json value delivered in chunks of any size, such as socket reads.
+ * Its state survives chunk boundaries anywhere, including inside strings, numbers and literals,
+ * and only the token being scanned is buffered. Events go to the given JsonHandler,
+ * or are assembled into a JsonElement available from Result() when no handler is given.
+ * Malformed input throws std::logic_error like JsonParser.
+ */
+class MINIJSON_API JsonPushParser {
+    public:
+        enum class Status {
+            NEED_MORE, // the value is not closed yet, feed more input
+            COMPLETE, // the value is closed, input after it is not consumed
+            STOPPED // the handler returned false
+        };
+
+        JsonPushParser();
+        explicit JsonPushParser(JsonHandler& handler);
+        JsonPushParser(const JsonPushParser&) = delete;
+        JsonPushParser& operator = (const JsonPushParser&) = delete;
+        ~JsonPushParser();
+
+        Status Feed(const char* data, std::size_t length);
+        Status Feed(const std::string& chunk);
+        // mark the end of input, a top level number is only known to be complete here
+        Status Finish();
+        // bytes consumed since construction or Reset(), the rest of the last chunk belongs to the next value
+        std::size_t Consumed() const;
+        JsonElement& Result();
+        // start over for the next value, the handler is kept
+        void Reset();
+    private:
+        enum class LexState { NONE, STRING, NUMBER, LITERAL };
+        enum class Expect { VALUE, VALUE_OR_ARRAY_END, KEY_OR_OBJECT_END, KEY, COLON, COMMA_OR_END, DONE };
+        struct Frame {
+            char type; // '{' or '['
+            std::size_t count;
+        };
+
+        std::size_t FeedString(const char* data, std::size_t pos, std::size_t length);
+        void StartToken(char ch, std::size_t position);
+        void FinishString();
+        void FinishNumber();
+        void FinishLiteral();
+        void Punctuation(char ch, std::size_t position);
+        void BeginValue(std::size_t position);
+        void EndValue(bool handlerResult);
+    private:
+        JsonHandler* m_handler { nullptr };
+        JsonElementBuilder* m_builder { nullptr }; // only used without a user handler
+        Status m_status { Status::NEED_MORE };
+        LexState m_lexState { LexState::NONE };
+        Expect m_expect { Expect::VALUE };
+        std::vector<Frame> m_stack {};
+        std::string m_token {}; // raw text of the token spanning chunk boundaries
+        bool m_escaped { false };
+        const char* m_literal { nullptr };
+        std::size_t m_literalLength = 0;
+        std::size_t m_tokenPosition = 0;
+        std::size_t m_consumed = 0;
+};
+
+/**
+ * JsonLinesReader parses newline delimited json (NDJSON / JSON Lines) on a pool of worker threads.
+ * The input is cut at line boundaries into batches of about SetBatchSize() bytes, at most two batches per thread
+ * are in flight, and every record is handed to the callback on the calling thread,
+ * either in input order or in the order the batches finish. Blank lines are skipped.
+ */
+class MINIJSON_API JsonLinesReader {
+    public:
+        // byte offset of the record in the input and the parsed record
+        using Callback = std::function<void(std::size_t offset, JsonElement& record)>;
+
+        // threadCount 0 uses one thread per hardware thread
+        explicit JsonLinesReader(std::size_t threadCount = 0);
+        // deliver records in input order (default) or as soon as their batch is parsed
+        void SetOrdered(bool ordered);
+        void SetBatchSize(std::size_t bytes);
+        std::size_t ThreadCount() const;
+
+        // return the number of records, a malformed record throws std::logic_error once the workers have stopped
+        std::size_t Read(const char* data, std::size_t length, const Callback& callback);
+        std::size_t Read(std::istream& stream, const Callback& callback);
+        // memory map the file like JsonParser::ParseFile
+        std::size_t ReadFile(const std::string& path, const Callback& callback);
+    private:
+        std::size_t m_threadCount = 1;
+        std::size_t m_batchSize = 1024 * 1024;
+        bool m_ordered = true;
+};
+
+/**
+ * JsonLazyElement is a view of one json value in a caller buffer, only its byte range is recorded.
+ * Nothing is parsed up front: a member or index lookup skips the values before it by bracket matching
+ * without decoding them, and scalars are decoded when read. Malformed text is only reported when reached.
+ * The buffer is borrowed and must outlive every element obtained from it.
+ * With duplicate keys the first member is returned, since the lookup stops at the first match.
+ */
+class MINIJSON_API JsonLazyElement {
+    public:
+        JsonLazyElement();
+        JsonLazyElement(const char* data, std::size_t length);
+        explicit JsonLazyElement(const std::string& str);
+        // the buffer is borrowed, a temporary string would dangle
+        explicit JsonLazyElement(std::string&& str) = delete;
+
+        bool IsNull() const;
+        bool IsBool() const;
+        bool IsLongInt() const;
+        bool IsDouble() const;
+        bool IsString() const;
+        bool IsJsonObject() const;
+        bool IsJsonArray() const;
+
+        bool ToBool() const;
+        double ToDouble() const;
+        int64_t ToLongInt() const;
+        std::string ToString() const;
+        // parse the whole range into a standalone JsonElement
+        JsonElement Materialize() const;
+
+        // number of elements of an array or members of an object, scans the whole value
+        std::size_t Size() const;
+        JsonLazyElement operator [] (std::size_t index) const;
+        // return false if the object has no such key
+        bool Find(const std::string& key, JsonLazyElement& element) const;
+        JsonLazyElement operator [] (const std::string& key) const;
+
+        // raw json text of the value
+        const char* Data() const;
+        std::size_t Length() const;
+        JsonElement::Type GetType() const;
+        std::string TypeName() const;
+    private:
+        static JsonLazyElement FromRange(const char* begin, const char* end);
+        void CheckContainer(char open) const;
+    private:
+        const char* m_begin { nullptr };
+        const char* m_end { nullptr };
+};
+
+/**
+ * JsonPath selects values of a document directly from its text, without building the DOM.
+ * Pointer() accepts RFC 6901 json pointers ("/a/b~1c/0"), Compile() additionally treats a "*" segment
+ * as every member or element and an "n:m" segment as the array indexes n <= i < m, either bound may be omitted.
+ * Keys holding those characters are written with the extra escapes "~2" for '*' and "~3" for ':' in Compile().
+ * Evaluation skips non-matching subtrees like JsonLazyElement, and only the matches are parsed into JsonElement.
+ * A key matches the first member of that name.
+ */
+class MINIJSON_API JsonPath {
+    public:
+        static JsonPath Pointer(const std::string& pointer);
+        static JsonPath Compile(const std::string& path);
+
+        // all matches in document order, empty if nothing matches
+        std::vector<JsonElement> Evaluate(const char* data, std::size_t length) const;
+        std::vector<JsonElement> Evaluate(const std::string& str) const;
+    private:
+        enum class SegmentType { KEY, WILDCARD, RANGE };
+        struct Segment {
+            SegmentType type;
+            std::string key; // unescaped key
+            std::size_t first; // array index of a KEY segment or start of a RANGE
+            std::size_t last; // end of a RANGE, exclusive
+        };
+
+        JsonPath(const std::string& expression, bool extended);
+        void Evaluate(std::size_t segmentIndex, const char* begin, const char* end,
+            std::vector<JsonElement>& results) const;
+    private:
+        std::vector<Segment> m_segments {};
+};
+
+/**
+ * JsonNode is a read-only node of a JsonDocument.
+ * Nodes, strings and container storage all live in the arena of the owning document,
+ * a node must not be used after its document has been destroyed, cleared or parsed again.
+ */
+class MINIJSON_API JsonNode {
+    public:
+        JsonNode();
+
+        bool IsNull() const;
+        bool IsBool() const;
+        bool IsLongInt() const;
+        bool IsDouble() const;
+        bool IsString() const;
+        bool IsJsonObject() const;
+        bool IsJsonArray() const;
+
+        bool ToBool() const;
+        double ToDouble() const;
+        int64_t ToLongInt() const;
+        std::string ToString() const;
+        // copy the whole subtree into a standalone JsonElement
+        JsonElement ToJsonElement() const;
+
+        // string content without copying, not null terminated
+        const char* StringData() const;
+        std::size_t StringLength() const;
+
+        // number of elements of an array or members of an object
+        std::size_t Size() const;
+        const JsonNode& operator [] (std::size_t index) const;
+        const JsonMember& MemberAt(std::size_t index) const;
+        // return nullptr if the object has no such key
+        const JsonNode* Find(const std::string& key) const;
+        const JsonNode& operator [] (const std::string& key) const;
+        // lookup by address only, key must come from JsonDocument::InternedKey() of the owning document
+        const JsonNode* FindInterned(const char* key) const;
+
+        JsonElement::Type GetType() const;
+        std::string TypeName() const;
+
+    private:
+        friend class JsonDocumentBuilder;
+
+        JsonElement::Type m_type = JsonElement::Type::JSON_NULL;
+        std::size_t m_size = 0; // string length, array or object size
+        union {
+            bool boolValue;
+            int64_t numberLongValue;
+            double numberDoubleValue;
+            const char* stringValue;
+            const JsonNode* elements;
+            const JsonMember* members;
+        } m_value {};
+};
+
+struct MINIJSON_API JsonMember {
+    const char* key;
+    std::size_t keyLength;
+    JsonNode value;
+
+    inline std::string Key() const { return std::string(key, keyLength); }
+};
+
+/**
+ * JsonDocument parses into JsonNode trees allocated from a bump arena.
+ * Destroying, clearing or re-parsing the document releases every node at once by freeing the arena blocks,
+ * no destructor runs per node. Parsing errors throw std::logic_error like JsonParser.
+ */
+class MINIJSON_API JsonDocument {
+    public:
+        JsonDocument();
+        JsonDocument(const JsonDocument&) = delete;
+        JsonDocument& operator = (const JsonDocument&) = delete;
+        ~JsonDocument();
+
+        // the input is only read during Parse, strings are copied into the arena
+        const JsonNode& Parse(const char* data, std::size_t length);
+        const JsonNode& Parse(const std::string& str);
+        const JsonNode& Root() const;
+        // drop all nodes, arena blocks are kept for the next Parse
+        void Clear();
+        // bytes reserved by the arena
+        std::size_t Capacity() const;
+        // share one copy of each distinct object key, takes effect from the next Parse
+        void InternKeys(bool enabled);
+        // the shared copy of key, nullptr if interning is off or no parsed object has this key
+        const char* InternedKey(const std::string& key) const;
+
+    private:
+        JsonArena* m_arena { nullptr };
+        JsonKeyPool* m_keys { nullptr };
+        JsonNode m_root {};
+};
+
+/**
+ * JsonTapeRef is a read-only cursor on a JsonTape entry, its API follows JsonElement/JsonNode.
+ * It is a pair of (tape, index) and is only valid while the tape is alive and not parsed again.
+ */
+class MINIJSON_API JsonTapeRef {
+    public:
+        JsonTapeRef(const JsonTape* tape, std::size_t index);
+
+        bool IsNull() const;
+        bool IsBool() const;
+        bool IsLongInt() const;
+        bool IsDouble() const;
+        bool IsString() const;
+        bool IsJsonObject() const;
+        bool IsJsonArray() const;
+
+        bool ToBool() const;
+        double ToDouble() const;
+        int64_t ToLongInt() const;
+        std::string ToString() const;
+        JsonElement ToJsonElement() const;
+
+        // string content without copying, not null terminated
+        const char* StringData() const;
+        std::size_t StringLength() const;
+
+        // number of elements of an array or members of an object
+        std::size_t Size() const;
+        // array element, O(index) since whole subtrees are skipped in O(1)
+        JsonTapeRef operator [] (std::size_t index) const;
+        // object member by position
+        std::string KeyAt(std::size_t index) const;
+        JsonTapeRef ValueAt(std::size_t index) const;
+        // return false if the object has no such key
+        bool Find(const std::string& key, JsonTapeRef& value) const;
+        JsonTapeRef operator [] (const std::string& key) const;
+
+        JsonElement::Type GetType() const;
+        std::string TypeName() const;
+        inline std::size_t Index() const { return m_index; }
+
+    private:
+        uint64_t Word(std::size_t offset = 0) const;
+        char Tag() const;
+        // index of the entry following this value
+        std::size_t NextIndex() const;
+        void CheckContainer(char tag) const;
+
+    private:
+        const JsonTape* m_tape;
+        std::size_t m_index;
+};
+
+/**
+ * JsonTape is a flat read-only representation of a json value: one contiguous tape of 64-bit entries plus a string buffer.
+ * Each entry keeps a type tag in its top 8 bits and a 56-bit payload:
+ *   'n' 't' 'f'       null, true, false
+ *   'l' 'd'           int64/double, the value bits are stored in the next word
+ *   '"'               payload is the offset of the string in the string buffer, the next word is its length
+ *   '{' '['           payload bits 0-31: index after the matching close entry, bits 32-55: saturated member/element count
+ *   '}' ']'           payload is the index of the matching open entry
+ * Object members are stored as a key string entry followed by the value entries.
+ */
+class MINIJSON_API JsonTape {
+    public:
+        JsonTape() = default;
+        // the input is only read during Parse, strings are copied into the string buffer
+        JsonTapeRef Parse(const char* data, std::size_t length);
+        JsonTapeRef Parse(const std::string& str);
+        JsonTapeRef Root() const;
+        inline const std::vector<uint64_t>& Tape() const { return m_tape; }
+        inline const std::string& StringBuffer() const { return m_strings; }
+
+    private:
+        void ParseNext(JsonScanner& scanner);
+        void ParseJsonObject(JsonScanner& scanner);
+        void ParseJsonArray(JsonScanner& scanner);
+        void AppendString(const std::string& str);
+        void CloseContainer(std::size_t openIndex, char closeTag, std::size_t count);
+        void EnterContainer(JsonScanner& scanner);
+
+    private:
+        std::vector<uint64_t> m_tape {};
+        std::string m_strings {};
+        std::size_t m_depth { 0 }; // open containers, capped at JsonParser::MAX_DEPTH like the parser
 };
 
 // use CastFromJsonElement & CastToJsonElement template methods to define some serialization/deserialzation rules
@@ -211,7 +892,7 @@ namespace rules {
         JsonObject object {};
         T* valueRef = reinterpret_cast<T*>((void*)&value);
         valueRef->_XURANUS_JSON_CPP_SERIALIZE_METHOD_(object, true);
-        ele = JsonElement(object);
+        ele = JsonElement(std::move(object));
         return;
     };
 
@@ -289,9 +970,9 @@ namespace rules {
         JsonElement secondItemElement;
         CastToJsonElement<typename T::first_type>(firstItemElement, value.first);
         CastToJsonElement<typename T::second_type>(secondItemElement, value.second);
-        array.push_back(firstItemElement);
-        array.push_back(secondItemElement);
-        ele = JsonElement(array);
+        array.push_back(std::move(firstItemElement));
+        array.push_back(std::move(secondItemElement));
+        ele = JsonElement(std::move(array));
         return;
     }
 
@@ -320,9 +1001,9 @@ namespace rules {
         for (const typename T::value_type& item: value) {
             JsonElement itemElement;
             CastToJsonElement<typename T::value_type>(itemElement, item);
-            array.push_back(itemElement);
+            array.push_back(std::move(itemElement));
         }
-        ele = JsonElement(array);
+        ele = JsonElement(std::move(array));
         return;
     }
 
@@ -350,12 +1031,12 @@ namespace rules {
         )>::type* = nullptr>
     void CastToJsonElement(JsonElement& ele, const T& value) {
         JsonObject object;
-        for (const std::pair<std::string, typename T::mapped_type>& p: value) {
+        for (const std::pair<const std::string, typename T::mapped_type>& p: value) {
             JsonElement valueElement;
             CastToJsonElement<typename T::mapped_type>(valueElement, p.second);
-            object[p.first] = valueElement;
+            object[p.first] = std::move(valueElement);
         }
-        ele = JsonElement(object);
+        ele = JsonElement(std::move(object));
         return;
     }
 
@@ -364,14 +1045,301 @@ namespace rules {
     {
         JsonElement ele {};
         CastToJsonElement<T>(ele, field);
-        object[key] = ele;
+        object[key] = std::move(ele);
     }
 
+    // a missing key leaves the field untouched
     template<typename T>
     void DeserializeFrom(const JsonObject& object, const std::string& key, T& field)
     {
-        JsonElement ele = object.find(key)->second;
-        CastFromJsonElement<T>(ele, field);
+        JsonObject::const_iterator it = object.find(key);
+        if (it != object.end()) {
+            CastFromJsonElement<T>(it->second, field);
+        }
+    }
+
+    // visitor of _XURANUS_JSON_CPP_SERIALIZE_METHOD_, moves every field to or from the JsonObject
+    class JsonObjectVisitor {
+        public:
+            JsonObjectVisitor(JsonObject& object, bool toJson) : m_object(object), m_toJson(toJson) {}
+
+            template<typename T>
+            void Field(const char* key, T& field)
+            {
+                if (m_toJson) {
+                    SerializeTo(m_object, key, field);
+                } else {
+                    DeserializeFrom(m_object, key, field);
+                }
+            }
+
+        private:
+            JsonObject& m_object;
+            bool m_toJson;
+    };
+
+    // read values straight from a JsonReader, same conversions as CastFromJsonElement without building any JsonElement
+    template<typename T>
+    auto CastFromJsonReader(JsonReader& reader, T& value) -> decltype(typename T::__XURANUS_JSON_SERIALIZATION_MAGIC__());
+
+    template<typename T, typename std::enable_if<std::is_same<T, std::string>::value>::type* = nullptr>
+    void CastFromJsonReader(JsonReader& reader, T& value) {
+        reader.ReadString(value);
+    }
+
+    template<typename T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type* = nullptr>
+    void CastFromJsonReader(JsonReader& reader, T& value) {
+        value = static_cast<T>(reader.ReadLongInt());
+    }
+
+    template<typename T, typename std::enable_if<std::is_floating_point<T>::value>::type* = nullptr>
+    void CastFromJsonReader(JsonReader& reader, T& value) {
+        value = static_cast<T>(reader.ReadDouble());
+    }
+
+    template<typename T, typename std::enable_if<std::is_same<T, bool>::value>::type* = nullptr>
+    void CastFromJsonReader(JsonReader& reader, T& value) {
+        value = reader.ReadBool();
+    }
+
+    // like CastFromJsonElement the pair is left untouched when the array has less than 2 elements
+    template<typename T, typename std::enable_if<
+        std::is_same<T, std::pair<typename T::first_type, typename T::second_type>>::value
+        >::type* = nullptr>
+    void CastFromJsonReader(JsonReader& reader, T& value) {
+        T pair {};
+        std::size_t count = 0;
+        reader.StartArray();
+        while (reader.NextElement()) {
+            if (count == 0) {
+                CastFromJsonReader<typename T::first_type>(reader, pair.first);
+            } else if (count == 1) {
+                CastFromJsonReader<typename T::second_type>(reader, pair.second);
+            } else {
+                reader.SkipValue();
+            }
+            count++;
+        }
+        if (count >= 2) {
+            value = std::move(pair);
+        }
+    }
+
+    template<typename T, typename std::enable_if<
+        std::is_same<T, std::vector<typename T::value_type>>::value ||
+        std::is_same<T, std::list<typename T::value_type>>::value
+        >::type* = nullptr>
+    void CastFromJsonReader(JsonReader& reader, T& value) {
+        value.clear();
+        reader.StartArray();
+        while (reader.NextElement()) {
+            value.emplace_back();
+            CastFromJsonReader<typename T::value_type>(reader, value.back());
+        }
+    }
+
+    template<typename T, typename std::enable_if<
+        std::is_same<std::string, typename T::key_type>::value && (
+        std::is_same<T, std::map<std::string, typename T::mapped_type>>::value ||
+        std::is_same<T, std::unordered_map<std::string, typename T::mapped_type>>::value
+        )>::type* = nullptr>
+    void CastFromJsonReader(JsonReader& reader, T& value) {
+        std::string key;
+        value.clear();
+        reader.StartObject();
+        while (reader.NextMember(key)) {
+            CastFromJsonReader<typename T::mapped_type>(reader, value[key]);
+        }
+    }
+
+    template<typename T>
+    void ReadField(JsonReader& reader, void* field)
+    {
+        CastFromJsonReader<T>(reader, *static_cast<T*>(field));
+    }
+
+    // defined after the CastToJsonWriter overloads
+    template<typename T>
+    void WriteField(JsonWriter& writer, const void* field);
+
+    // visitor of _XURANUS_JSON_CPP_VISIT_METHOD_, collects the keys, offsets and readers in declaration order
+    class JsonFieldCollector {
+        public:
+            JsonFieldCollector(JsonFieldTable& table, const void* object, std::size_t size)
+                : m_table(table), m_object(reinterpret_cast<uintptr_t>(object)), m_size(size) {}
+
+            template<typename T>
+            void Field(const char* key, T& field)
+            {
+                uintptr_t address = reinterpret_cast<uintptr_t>(&field);
+                if (address >= m_object && address - m_object + sizeof(T) <= m_size) {
+                    m_table.Add(key, &ReadField<T>, &WriteField<T>, static_cast<std::size_t>(address - m_object));
+                } else {
+                    m_table.Add(key);
+                }
+            }
+
+        private:
+            JsonFieldTable& m_table;
+            uintptr_t m_object;
+            std::size_t m_size;
+    };
+
+    // visitor of _XURANUS_JSON_CPP_VISIT_METHOD_, reads the current member into the field at a JsonFieldTable position,
+    // only used for fields without a reader in the table
+    class JsonReaderVisitor {
+        public:
+            JsonReaderVisitor(JsonReader& reader, std::size_t field) : m_reader(reader), m_field(field) {}
+
+            template<typename T>
+            void Field(const char*, T& field)
+            {
+                if (m_position++ == m_field) {
+                    CastFromJsonReader<T>(m_reader, field);
+                }
+            }
+
+        private:
+            JsonReader& m_reader;
+            std::size_t m_field;
+            std::size_t m_position { 0 };
+    };
+
+    // the keys of a type are the same for every instance, value is only visited on the first call
+    template<typename T>
+    const JsonFieldTable& FieldTableOf(T& value)
+    {
+        static const JsonFieldTable table = [&value]() {
+            JsonFieldTable fields;
+            JsonFieldCollector collector(fields, &value, sizeof(T));
+            value._XURANUS_JSON_CPP_VISIT_METHOD_(collector);
+            return fields;
+        }();
+        return table;
+    }
+
+    // members without a field are skipped, fields without a member keep their value
+    template<typename T>
+    auto CastFromJsonReader(JsonReader& reader, T& value) -> decltype(typename T::__XURANUS_JSON_SERIALIZATION_MAGIC__()) {
+        const JsonFieldTable& table = FieldTableOf(value);
+        std::string key;
+        std::size_t next = 0;
+        reader.StartObject();
+        while (reader.NextMember(key)) {
+            std::size_t field = table.Find(key, next);
+            if (field == JsonFieldTable::NO_FIELD) {
+                reader.SkipValue();
+                continue;
+            }
+            if (!table.Read(field, reader, &value)) {
+                JsonReaderVisitor visitor(reader, field);
+                value._XURANUS_JSON_CPP_VISIT_METHOD_(visitor);
+            }
+            next = field + 1;
+        }
+    }
+
+    // write values straight to a JsonWriter, same output as CastToJsonElement without building any JsonElement
+    template<typename T>
+    auto CastToJsonWriter(JsonWriter& writer, const T& value) -> decltype(typename T::__XURANUS_JSON_SERIALIZATION_MAGIC__());
+
+    template<typename T, typename std::enable_if<std::is_same<T, std::string>::value>::type* = nullptr>
+    void CastToJsonWriter(JsonWriter& writer, const T& value) {
+        writer.String(value);
+    }
+
+    template<typename T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type* = nullptr>
+    void CastToJsonWriter(JsonWriter& writer, const T& value) {
+        writer.Int64(static_cast<int64_t>(value));
+    }
+
+    template<typename T, typename std::enable_if<std::is_floating_point<T>::value>::type* = nullptr>
+    void CastToJsonWriter(JsonWriter& writer, const T& value) {
+        writer.Double(static_cast<double>(value));
+    }
+
+    template<typename T, typename std::enable_if<std::is_same<T, bool>::value>::type* = nullptr>
+    void CastToJsonWriter(JsonWriter& writer, const T& value) {
+        writer.Bool(value);
+    }
+
+    template<typename T, typename std::enable_if<
+        std::is_same<T, std::pair<typename T::first_type, typename T::second_type>>::value
+        >::type* = nullptr>
+    void CastToJsonWriter(JsonWriter& writer, const T& value) {
+        writer.StartArray();
+        CastToJsonWriter<typename T::first_type>(writer, value.first);
+        CastToJsonWriter<typename T::second_type>(writer, value.second);
+        writer.EndArray();
+    }
+
+    template<typename T, typename std::enable_if<
+        std::is_same<T, std::vector<typename T::value_type>>::value ||
+        std::is_same<T, std::list<typename T::value_type>>::value
+        >::type* = nullptr>
+    void CastToJsonWriter(JsonWriter& writer, const T& value) {
+        writer.StartArray();
+        for (const typename T::value_type& item: value) {
+            CastToJsonWriter<typename T::value_type>(writer, item);
+        }
+        writer.EndArray();
+    }
+
+    template<typename T, typename std::enable_if<
+        std::is_same<std::string, typename T::key_type>::value && (
+        std::is_same<T, std::map<std::string, typename T::mapped_type>>::value ||
+        std::is_same<T, std::unordered_map<std::string, typename T::mapped_type>>::value
+        )>::type* = nullptr>
+    void CastToJsonWriter(JsonWriter& writer, const T& value) {
+        writer.StartObject();
+        for (const std::pair<const std::string, typename T::mapped_type>& p: value) {
+            writer.Key(p.first);
+            CastToJsonWriter<typename T::mapped_type>(writer, p.second);
+        }
+        writer.EndObject();
+    }
+
+    template<typename T>
+    void WriteField(JsonWriter& writer, const void* field)
+    {
+        CastToJsonWriter<T>(writer, *static_cast<const T*>(field));
+    }
+
+    // visitor of _XURANUS_JSON_CPP_VISIT_METHOD_, writes every key once like the JsonObject path,
+    // at the position of its first field with the value of its last field
+    class JsonWriterVisitor {
+        public:
+            JsonWriterVisitor(JsonWriter& writer, const JsonFieldTable& table, const void* object)
+                : m_writer(writer), m_table(table), m_object(object) {}
+
+            template<typename T>
+            void Field(const char* key, const T& field)
+            {
+                std::size_t position = m_position++;
+                if (m_table.IsRepeated(position)) {
+                    return;
+                }
+                m_writer.Key(key, std::char_traits<char>::length(key));
+                if (!m_table.WriteLastRepeat(position, m_writer, m_object)) {
+                    CastToJsonWriter<T>(m_writer, field);
+                }
+            }
+
+        private:
+            JsonWriter& m_writer;
+            const JsonFieldTable& m_table;
+            const void* m_object;
+            std::size_t m_position { 0 };
+    };
+
+    template<typename T>
+    auto CastToJsonWriter(JsonWriter& writer, const T& value) -> decltype(typename T::__XURANUS_JSON_SERIALIZATION_MAGIC__()) {
+        // the visit method is shared with deserialization and is not const, fields are only read here
+        T* valueRef = const_cast<T*>(&value);
+        JsonWriterVisitor visitor(writer, FieldTableOf(*valueRef), valueRef);
+        writer.StartObject();
+        valueRef->_XURANUS_JSON_CPP_VISIT_METHOD_(visitor);
+        writer.EndObject();
     }
 
 }
@@ -381,6 +1349,11 @@ namespace util {
     template<typename T>
     auto Serialize(const T& value) -> decltype(typename T::__XURANUS_JSON_SERIALIZATION_MAGIC__(), std::string());
 
+    // append value to the writer, so that it can be part of a larger document or streamed to its sink
+    template<typename T>
+    auto Serialize(const T& value, JsonWriter& writer) -> decltype(typename T::__XURANUS_JSON_SERIALIZATION_MAGIC__());
+
+    // fields are assigned while reading, value may be partially filled when malformed input throws
     template<typename T>
     auto Deserialize(const std::string& jsonStr, T& value) -> decltype(typename T::__XURANUS_JSON_SERIALIZATION_MAGIC__());
 }
@@ -389,19 +1362,25 @@ namespace util {
 template<typename T>
 auto util::Serialize(const T& value) -> decltype(typename T::__XURANUS_JSON_SERIALIZATION_MAGIC__(), std::string())
 {
-    JsonObject object {};
-    auto valuePtr = const_cast<typename std::remove_const<T>::type*>(&value);
-    valuePtr->_XURANUS_JSON_CPP_SERIALIZE_METHOD_(object, true); 
-    return object.Serialize();
+    // no JsonObject is built, fields are written to the buffer as they are visited
+    JsonWriter writer;
+    rules::CastToJsonWriter(writer, value);
+    return writer.TakeString();
+}
+
+template<typename T>
+auto util::Serialize(const T& value, JsonWriter& writer) -> decltype(typename T::__XURANUS_JSON_SERIALIZATION_MAGIC__())
+{
+    rules::CastToJsonWriter(writer, value);
 }
 
 template<typename T>
 auto util::Deserialize(const std::string& jsonStr, T& value) -> decltype(typename T::__XURANUS_JSON_SERIALIZATION_MAGIC__())
 {
-    JsonParser parser(jsonStr);
-    JsonElement ele = parser.Parse();
-    JsonObject object = ele.AsJsonObject();
-    value._XURANUS_JSON_CPP_SERIALIZE_METHOD_(object, false);
+    // no JsonElement is built, fields are filled while the tokens are read
+    JsonReader reader(jsonStr);
+    rules::CastFromJsonReader(reader, value);
+    reader.Finish();
 }
 
 }
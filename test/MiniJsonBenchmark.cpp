@@ -0,0 +1,73 @@
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include "../Json.h"
+
+using namespace xuranus::minijson;
+
+// every block carries its size in a header so that live heap bytes can be tracked
+static std::size_t g_liveBytes = 0;
+static const std::size_t HEADER_SIZE = 16;
+
+void* operator new(std::size_t size)
+{
+    char* block = static_cast<char*>(std::malloc(size + HEADER_SIZE));
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    *reinterpret_cast<std::size_t*>(block) = size;
+    g_liveBytes += size;
+    return block + HEADER_SIZE;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    if (ptr == nullptr) {
+        return;
+    }
+    char* block = static_cast<char*>(ptr) - HEADER_SIZE;
+    g_liveBytes -= *reinterpret_cast<std::size_t*>(block);
+    std::free(block);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+static std::string MakeArray(std::size_t count, const std::string& item)
+{
+    std::string str = "[";
+    for (std::size_t i = 0; i < count; ++i) {
+        str += (i == 0 ? "" : ",") + item;
+    }
+    str += "]";
+    return str;
+}
+
+// bytes per array element: the element itself plus everything it owns on the heap
+static void Report(const char* name, const std::string& str, std::size_t count)
+{
+    std::size_t before = g_liveBytes;
+    JsonElement element = JsonParser(str).Parse();
+    JsonArray& array = element.AsJsonArray();
+    array.shrink_to_fit();
+    std::size_t heapBytes = g_liveBytes - before;
+    std::printf("%-16s %8.2f bytes/node\n", name, static_cast<double>(heapBytes) / static_cast<double>(count));
+}
+
+int main()
+{
+    const std::size_t count = 100000;
+    std::printf("sizeof(JsonElement) = %zu\n", sizeof(JsonElement));
+    Report("long int", MakeArray(count, "1234567"), count);
+    Report("double", MakeArray(count, "3.14159"), count);
+    Report("bool", MakeArray(count, "true"), count);
+    Report("null", MakeArray(count, "null"), count);
+    Report("short string", MakeArray(count, "\"abcdefgh\""), count);
+    Report("long string", MakeArray(count, "\"abcdefghijklmnopqrstuvwxyz\""), count);
+    Report("small object", MakeArray(count, "{\"k\":1}"), count);
+    return 0;
+}
@@ -10,12 +10,56 @@
 ================================================================*/
 
 #include <gtest/gtest.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
 #include "StructSample.h"
 #include "../Json.h"
 
 using namespace xuranus::minijson;
 
+namespace {
+    // number of global operator new calls, used to check how many heap blocks an operation creates
+    std::size_t g_allocationCount = 0;
+    // number of non null blocks given back to global operator delete
+    std::size_t g_deallocationCount = 0;
+}
+
+// both are kept out of line, gcc would otherwise pair the inlined malloc and free with the operators and warn
+#if defined(__GNUC__) && !defined(__clang__)
+    #define MINIJSON_TEST_NOINLINE __attribute__((noinline))
+#else
+    #define MINIJSON_TEST_NOINLINE
+#endif
+
+MINIJSON_TEST_NOINLINE void* operator new(std::size_t size)
+{
+    ++g_allocationCount;
+    void* ptr = std::malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+MINIJSON_TEST_NOINLINE void operator delete(void* ptr) noexcept
+{
+    if (ptr != nullptr) {
+        ++g_deallocationCount;
+    }
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    operator delete(ptr);
+}
+
 TEST(SerializationTest, BasicString) {
     std::string jsonStr = R"("this is a basic string")";
     std::string str = "this is a basic string";
@@ -39,6 +83,16 @@ TEST(SerializationTest, EscapedString) {
     EXPECT_EQ(element.Serialize(), jsonStr);
 }
 
+TEST(SerializationTest, UnicodeEscapedString) {
+    std::string jsonStr = R"("caf\u00e9 \u4e2d\u6587 \ud83d\ude00 and a plain run longer than sixteen bytes\/")";
+    JsonElement element = JsonParser(jsonStr).Parse();
+    EXPECT_EQ(element.ToString(), "caf\xc3\xa9 \xe4\xb8\xad\xe6\x96\x87 \xf0\x9f\x98\x80 and a plain run longer than sixteen bytes/");
+    EXPECT_THROW(JsonParser(R"("\q")").Parse(), std::logic_error);
+    EXPECT_THROW(JsonParser(R"("\u12")").Parse(), std::logic_error);
+    EXPECT_THROW(JsonParser(R"("\ud83d")").Parse(), std::logic_error);
+    EXPECT_THROW(JsonParser(R"("unterminated \")").Parse(), std::logic_error);
+}
+
 TEST(SerializationTest, NullType) {
     std::string str = "null";
     JsonElement element = JsonParser(str).Parse();
@@ -100,6 +154,42 @@ TEST(SerializationTest, LongIntNumber) {
     EXPECT_EQ(element.AsLongInt(), 1099511627776L);
 }
 
+TEST(SerializationTest, NumberBoundaries) {
+    EXPECT_EQ(JsonParser("9223372036854775807").Parse().AsLongInt(), INT64_MAX);
+    EXPECT_EQ(JsonParser("-9223372036854775808").Parse().AsLongInt(), INT64_MIN);
+    JsonElement overflow = JsonParser("9223372036854775808").Parse();
+    EXPECT_TRUE(overflow.IsDouble());
+    EXPECT_EQ(overflow.AsDouble(), 9223372036854775808.0);
+    EXPECT_EQ(JsonParser("0.30000000000000004").Parse().AsDouble(), 0.30000000000000004);
+    EXPECT_EQ(JsonParser("1e-9").Parse().AsDouble(), 1e-9);
+    EXPECT_EQ(JsonParser("2.2250738585072014e-308").Parse().AsDouble(), 2.2250738585072014e-308);
+    EXPECT_EQ(JsonParser("[1.5e3]").Parse().AsJsonArray()[0].AsDouble(), 1500.0);
+    EXPECT_THROW(JsonParser("-").Parse(), std::logic_error);
+    EXPECT_THROW(JsonParser("1e").Parse(), std::logic_error);
+    EXPECT_THROW(JsonParser("1e+").Parse(), std::logic_error);
+}
+
+TEST(SerializationTest, NumberRoundTrip) {
+    EXPECT_EQ(JsonElement(1e-9).Serialize(), "1e-9");
+    EXPECT_EQ(JsonElement(0.1).Serialize(), "0.1");
+    EXPECT_EQ(JsonElement(0.30000000000000004).Serialize(), "0.30000000000000004");
+    EXPECT_EQ(JsonElement(1.7976931348623157e308).Serialize(), "1.7976931348623157e+308");
+    EXPECT_EQ(JsonElement(-0.000123).Serialize(), "-0.000123");
+    EXPECT_EQ(JsonElement(static_cast<int64_t>(INT64_MIN)).Serialize(), "-9223372036854775808");
+    std::mt19937_64 random(114514);
+    for (int i = 0; i < 10000; ++i) {
+        uint64_t bits = random();
+        double value = 0;
+        std::memcpy(&value, &bits, sizeof(value));
+        if (std::isnan(value) || std::isinf(value)) {
+            continue;
+        }
+        // integral values are written without a fraction and may come back as long int
+        JsonElement parsed = JsonParser(JsonElement(value).Serialize()).Parse();
+        EXPECT_EQ(parsed.IsLongInt() ? static_cast<double>(parsed.AsLongInt()) : parsed.AsDouble(), value);
+    }
+}
+
 TEST(SerializationTest, JsonElementConstructorTest) {
     JsonElement jsonNull(JsonElement::Type::JSON_NULL);
     EXPECT_TRUE(jsonNull.IsNull());
@@ -143,6 +233,230 @@ TEST(SerializationTest, JsonParserBasicTest) {
     EXPECT_EQ(object["skills"].AsJsonArray()[2].AsString(), "Python");
 }
 
+TEST(SerializationTest, JsonParserBorrowedBuffer) {
+    // only the first 14 bytes belong to the json, the rest of the buffer must not be scanned
+    std::string buffer = R"({"id":[1,2,3]} trailing garbage)";
+    JsonParser parser(buffer.data(), 14);
+    JsonElement element = parser.Parse();
+    EXPECT_EQ(element.Serialize(), R"({"id":[1,2,3]})");
+    EXPECT_TRUE(parser.IsValid());
+    EXPECT_FALSE(JsonParser(buffer).IsValid());
+    EXPECT_EQ(JsonParser(std::string("[true,null]")).Parse().Serialize(), "[true,null]");
+}
+
+TEST(SerializationTest, JsonParserParseFile) {
+    const std::string path = "minijson_parse_file_test.json";
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    ASSERT_NE(file, nullptr);
+    std::fputs(R"({"name" : "xuranus", "skills" : ["C++", "Java"]})", file);
+    std::fclose(file);
+    JsonElement element = JsonParser::ParseFile(path);
+    std::remove(path.c_str());
+    EXPECT_EQ(element.Serialize(), R"({"name":"xuranus","skills":["C++","Java"]})");
+    EXPECT_THROW(JsonParser::ParseFile(path), std::logic_error);
+}
+
+TEST(SerializationTest, JsonElementMoveSemantics) {
+    JsonElement element = JsonParser(R"({"skills" : ["C++", "Java"]})").Parse();
+    JsonElement moved(std::move(element));
+    EXPECT_TRUE(element.IsNull());
+    EXPECT_EQ(moved.Serialize(), R"({"skills":["C++","Java"]})");
+
+    element = std::move(moved);
+    EXPECT_TRUE(moved.IsNull());
+    EXPECT_EQ(element.Serialize(), R"({"skills":["C++","Java"]})");
+    EXPECT_EQ(element.AsJsonObject()["skills"].AsJsonArray()[1].AsString(), "Java");
+
+    // the previous value is released by the assignment, not later with the source
+    JsonElement source(std::string("a string too long to stay inline"));
+    std::size_t before = g_deallocationCount;
+    element = std::move(source);
+    EXPECT_GT(g_deallocationCount, before);
+    EXPECT_TRUE(source.IsNull());
+    EXPECT_EQ(element.ToString(), "a string too long to stay inline");
+
+    // a child moved over the element that owns it
+    JsonElement parent = JsonParser(R"([[1, 2], 3])").Parse();
+    parent = std::move(parent.AsJsonArray()[0]);
+    EXPECT_EQ(parent.Serialize(), "[1,2]");
+}
+
+TEST(SerializationTest, ParserBuildsEachNodeOnce) {
+    // short keys stay inline, so both the parse and the deep copy allocate exactly one member block per object
+    std::string jsonStr = R"({"a":{"b":{"c":{"d":{"e":{"f":{"g":"x","h":1.5}}}}}}})";
+    JsonParser parser(jsonStr);
+
+    std::size_t before = g_allocationCount;
+    JsonElement element = parser.Parse();
+    std::size_t parseAllocations = g_allocationCount - before;
+
+    before = g_allocationCount;
+    JsonElement copied = element;
+    std::size_t copyAllocations = g_allocationCount - before;
+
+    EXPECT_EQ(parseAllocations, copyAllocations);
+    EXPECT_EQ(copied.Serialize(), jsonStr);
+}
+
+TEST(JsonDocumentTest, ParseIntoArena) {
+    std::string jsonStr = R"(
+        {
+            "name" : "xuranus",
+            "age" : 300,
+            "height" : 1.75,
+            "alive" : true,
+            "spouse" : null,
+            "skills" : ["C++", "Java", "Python"],
+            "empty" : {}
+        }
+    )";
+    JsonDocument document;
+    const JsonNode& root = document.Parse(jsonStr);
+    EXPECT_TRUE(root.IsJsonObject());
+    EXPECT_EQ(root.Size(), 7);
+    EXPECT_EQ(root.MemberAt(0).Key(), "name");
+    EXPECT_EQ(root["name"].ToString(), "xuranus");
+    EXPECT_EQ(root["age"].ToLongInt(), 300);
+    EXPECT_EQ(root["height"].ToDouble(), 1.75);
+    EXPECT_TRUE(root["alive"].ToBool());
+    EXPECT_TRUE(root["spouse"].IsNull());
+    EXPECT_EQ(root["skills"].Size(), 3);
+    EXPECT_EQ(root["skills"][2].ToString(), "Python");
+    EXPECT_EQ(root["empty"].Size(), 0);
+    EXPECT_EQ(root.Find("missing"), nullptr);
+    EXPECT_THROW(root["skills"][3], std::logic_error);
+    EXPECT_EQ(root.ToJsonElement().Serialize(), JsonParser(jsonStr).Parse().Serialize());
+    EXPECT_THROW(document.Parse("[1, 2"), std::logic_error);
+    const std::size_t depth = 60000;
+    EXPECT_THROW(document.Parse(std::string(depth, '[') + std::string(depth, ']')), std::logic_error);
+
+    EXPECT_EQ(document.Parse("[1.5e3]")[0].ToLongInt(), 1500);
+    EXPECT_THROW(document.Parse("[1e19]")[0].ToLongInt(), std::logic_error);
+}
+
+TEST(JsonDocumentTest, ArenaAllocationsDoNotGrowWithNodes) {
+    std::string jsonStr = "[";
+    for (int i = 0; i < 1000; ++i) {
+        jsonStr += R"({"id":1,"name":"a long enough name to leave the SSO buffer"},)";
+    }
+    jsonStr.back() = ']';
+    JsonDocument document;
+    document.Parse(jsonStr);
+    // the second parse reuses the arena blocks and the builder stacks only grow a few times
+    std::size_t before = g_allocationCount;
+    const JsonNode& root = document.Parse(jsonStr);
+    EXPECT_LT(g_allocationCount - before, 100);
+    EXPECT_EQ(root.Size(), 1000);
+    EXPECT_EQ(root[999]["name"].ToString(), "a long enough name to leave the SSO buffer");
+}
+
+TEST(JsonDocumentTest, InternRepeatedKeys) {
+    std::string jsonStr = "[";
+    for (int i = 0; i < 5000; ++i) {
+        jsonStr += R"({"a_rather_long_identifier_key_name":1,"another_long_key_for_the_description":"x","":null},)";
+    }
+    jsonStr.back() = ']';
+    JsonDocument plain;
+    plain.Parse(jsonStr);
+    JsonDocument interned;
+    interned.InternKeys(true);
+    const JsonNode& root = interned.Parse(jsonStr);
+    EXPECT_LT(interned.Capacity(), plain.Capacity());
+
+    // every record shares the same key copies, lookups can compare addresses
+    EXPECT_EQ(root[0].MemberAt(1).key, root[4999].MemberAt(1).key);
+    const char* key = interned.InternedKey("another_long_key_for_the_description");
+    EXPECT_EQ(key, root[0].MemberAt(1).key);
+    EXPECT_EQ(root[123].FindInterned(key)->ToString(), "x");
+    EXPECT_TRUE(root[123].FindInterned(interned.InternedKey(""))->IsNull());
+    EXPECT_EQ(root[123].FindInterned("another_long_key_for_the_description"), nullptr);
+    EXPECT_EQ(interned.InternedKey("missing"), nullptr);
+    EXPECT_EQ(plain.InternedKey("another_long_key_for_the_description"), nullptr);
+    EXPECT_EQ(root[1]["a_rather_long_identifier_key_name"].ToLongInt(), 1);
+    EXPECT_EQ(root.ToJsonElement().Serialize(), JsonParser(jsonStr).Parse().Serialize());
+
+    interned.Parse(R"({"other":1})");
+    EXPECT_EQ(interned.InternedKey("another_long_key_for_the_description"), nullptr);
+    EXPECT_EQ(interned.InternedKey(""), nullptr);
+    EXPECT_EQ(interned.Root().FindInterned(interned.InternedKey("other"))->ToLongInt(), 1);
+    EXPECT_EQ(plain.InternedKey(""), nullptr);
+}
+
+TEST(JsonTapeTest, ParseIntoTape) {
+    std::string jsonStr = R"(
+        {
+            "name" : "xuranus",
+            "age" : 300,
+            "height" : 1.75,
+            "skills" : ["C++", "Java", "Python"],
+            "books" : [{"id" : 1, "tags" : [[], {}]}, {"id" : 2}],
+            "alive" : false,
+            "spouse" : null
+        }
+    )";
+    JsonTape tape;
+    JsonTapeRef root = tape.Parse(jsonStr);
+    EXPECT_TRUE(root.IsJsonObject());
+    EXPECT_EQ(root.Size(), 7);
+    EXPECT_EQ(root.KeyAt(4), "books");
+    EXPECT_EQ(root["name"].ToString(), "xuranus");
+    EXPECT_EQ(root["age"].ToLongInt(), 300);
+    EXPECT_EQ(root["height"].ToDouble(), 1.75);
+    EXPECT_EQ(root["skills"][1].ToString(), "Java");
+    EXPECT_EQ(root["books"].Size(), 2);
+    EXPECT_EQ(root["books"][1]["id"].ToLongInt(), 2);
+    EXPECT_EQ(root["books"][0]["tags"][1].Size(), 0);
+    EXPECT_FALSE(root.ValueAt(5).ToBool());
+    EXPECT_TRUE(root["spouse"].IsNull());
+    JsonTapeRef missing = root;
+    EXPECT_FALSE(root.Find("missing", missing));
+    EXPECT_THROW(root["skills"][3], std::logic_error);
+    EXPECT_EQ(root.ToJsonElement().Serialize(), JsonParser(jsonStr).Parse().Serialize());
+    // the open entry of "books" points past its subtree, right at the two words of the "alive" key
+    std::size_t skipIndex = static_cast<std::size_t>(tape.Tape()[root["books"].Index()] & 0xFFFFFFFF);
+    EXPECT_EQ(root["alive"].Index(), skipIndex + 2);
+
+    JsonTape numbers;
+    JsonTapeRef array = numbers.Parse("[-2.5, -1e19]");
+    EXPECT_EQ(array[0].ToLongInt(), -2);
+    EXPECT_THROW(array[1].ToLongInt(), std::logic_error);
+
+    const std::size_t depth = 60000;
+    EXPECT_THROW(numbers.Parse(std::string(depth, '[') + std::string(depth, ']')), std::logic_error);
+    EXPECT_TRUE(numbers.Tape().empty());
+}
+
+TEST(SerializationTest, StructuralIndexMatchesScanner) {
+    std::string padding(61, ' ');
+    std::vector<std::string> inputs = {
+        R"({"name" : "xuranus", "skills" : ["C++", "Java"], "age" : 300, "ok" : true, "none" : null})",
+        // escaped quotes and backslashes crossing the 64 bytes block boundary
+        "[" + padding + R"("\\\"", "a\"b", "é\\", -1.5e3 ,  {"k" :[ ]}   ])",
+        "  \n\t[1,\n 2 ,3]  \r\n",
+        "[1, 2 3]",
+        "{\"a\" 1}",
+        "[1 x]",
+        "[\"unterminated" + padding + "]"
+    };
+    for (const std::string& input: inputs) {
+        std::string expected;
+        std::string actual;
+        try {
+            expected = JsonParser(input).Parse().Serialize();
+        } catch (const std::logic_error& e) {
+            expected = e.what();
+        }
+        try {
+            JsonParser parser(input);
+            parser.UseStructuralIndex(true);
+            actual = parser.Parse().Serialize();
+        } catch (const std::logic_error& e) {
+            actual = e.what();
+        }
+        EXPECT_EQ(expected, actual) << input;
+    }
+}
+
 TEST(SerializationTest, JsonElementSerialization) {
     EXPECT_EQ(JsonElement("hello world").Serialize(), R"("hello world")");
     EXPECT_EQ(JsonElement(true).Serialize(), "true");
@@ -152,7 +466,473 @@ TEST(SerializationTest, JsonElementSerialization) {
     JsonObject object {};
     object["name"] = JsonElement("xuranus");
     object["age"] = JsonElement(300.0); // TODO:: solve literal ambigous issue
-    EXPECT_EQ(object.Serialize(), R"({"age":300,"name":"xuranus"})");
+    EXPECT_EQ(object.Serialize(), R"({"name":"xuranus","age":300})");
+}
+
+TEST(SerializationTest, JsonObjectKeepsInsertionOrder) {
+    JsonObject object;
+    std::string expected = "{";
+    for (int i = 99; i >= 0; --i) {
+        std::string key = "key" + std::to_string(i);
+        object[key] = JsonElement(static_cast<int64_t>(i));
+        expected += (i == 99 ? "\"" : ",\"") + key + "\":" + std::to_string(i);
+    }
+    expected += "}";
+    EXPECT_EQ(object.size(), 100);
+    EXPECT_EQ(object.Serialize(), expected);
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(object.at("key" + std::to_string(i)).AsLongInt(), i);
+    }
+    EXPECT_EQ(object.count("key100"), 0);
+    EXPECT_TRUE(object.find("missing") == object.end());
+    EXPECT_THROW(object.at("missing"), std::out_of_range);
+
+    // erasing keeps the order of the remaining members and the index stays usable
+    EXPECT_EQ(object.erase("key50"), 1);
+    EXPECT_EQ(object.erase("key50"), 0);
+    EXPECT_EQ(object.count("key50"), 0);
+    EXPECT_EQ(object["key49"].AsLongInt(), 49);
+    EXPECT_FALSE(object.emplace("key0", JsonElement(true)).second);
+    EXPECT_TRUE(object.emplace("key50", JsonElement(true)).second);
+    EXPECT_EQ((object.end() - 1)->first, "key50");
+
+    // a duplicate key keeps its first position and takes the last value
+    JsonElement element = JsonParser(std::string(R"({"b":1,"a":2,"b":3})")).Parse();
+    EXPECT_EQ(element.Serialize(), R"({"b":3,"a":2})");
+}
+
+TEST(SerializationTest, JsonObjectKeyContract) {
+    // read only access never hands out a writable key
+    static_assert(std::is_const<std::remove_reference<
+        decltype((std::declval<const JsonObject&>().begin()->first))>::type>::value, "const key");
+    static_assert(std::is_const<std::remove_reference<
+        decltype((std::declval<JsonObject&>().cbegin()->first))>::type>::value, "const key");
+
+    // values may be written through an iterator, a key is renamed by erase and emplace, both keep the index valid
+    JsonObject object;
+    for (int i = 0; i < 20; ++i) {
+        object["key" + std::to_string(i)] = JsonElement(static_cast<int64_t>(i));
+    }
+    for (JsonObject::value_type& member : object) {
+        member.second = JsonElement(member.second.AsLongInt() * 2);
+    }
+    JsonElement value = object.at("key7");
+    object.erase("key7");
+    EXPECT_TRUE(object.emplace("renamed", std::move(value)).second);
+    EXPECT_EQ(object.count("key7"), 0);
+    EXPECT_EQ(object.at("renamed").AsLongInt(), 14);
+    for (int i = 0; i < 20; ++i) {
+        if (i != 7) {
+            EXPECT_EQ(object.at("key" + std::to_string(i)).AsLongInt(), i * 2);
+        }
+    }
+}
+
+TEST(SerializationTest, JsonWriterEvents) {
+    JsonWriter writer;
+    writer.StartObject();
+    writer.Key("list");
+    writer.StartArray();
+    writer.Int64(-1);
+    writer.Double(0.5);
+    writer.Bool(false);
+    writer.Null();
+    writer.StartObject();
+    writer.EndObject();
+    writer.EndArray();
+    writer.Key("text");
+    writer.String("a\"b\n");
+    writer.EndObject();
+    EXPECT_EQ(writer.GetString(), R"({"list":[-1,0.5,false,null,{}],"text":"a\"b\n"})");
+
+    std::ostringstream stream;
+    {
+        JsonWriter streamWriter(stream);
+        streamWriter.Write(JsonParser(writer.GetString()).Parse());
+    }
+    EXPECT_EQ(stream.str(), writer.TakeString());
+    EXPECT_TRUE(writer.GetString().empty());
+    writer.StartArray();
+    writer.EndArray();
+    EXPECT_EQ(writer.TakeString(), "[]");
+}
+
+TEST(SerializationTest, SerializeDoesNotCopyContainers) {
+    JsonArray array;
+    for (int i = 0; i < 1000; ++i) {
+        JsonObject object;
+        object["value"] = JsonElement(static_cast<int64_t>(i));
+        JsonArray list;
+        list.push_back(JsonElement(true));
+        list.push_back(JsonElement(1.5));
+        object["list"] = JsonElement(std::move(list));
+        array.push_back(JsonElement(std::move(object)));
+    }
+    JsonElement element(std::move(array));
+    std::size_t before = g_allocationCount;
+    std::string str = element.Serialize();
+    // only the growth of the output buffer allocates
+    EXPECT_LT(g_allocationCount - before, 64);
+    EXPECT_EQ(JsonParser(str).Parse().Serialize(), str);
+}
+
+namespace {
+    // sum the numbers of a document and echo the events through a JsonWriter
+    class EchoHandler : public JsonHandler {
+    public:
+        bool StartObject() override { writer.StartObject(); return true; }
+        bool Key(const char* key, std::size_t length) override { writer.Key(key, length); return true; }
+        bool EndObject(std::size_t) override { writer.EndObject(); return true; }
+        bool StartArray() override { writer.StartArray(); return true; }
+        bool EndArray(std::size_t) override { writer.EndArray(); return true; }
+        bool String(const char* str, std::size_t length) override { writer.String(str, length); return true; }
+        bool Int64(int64_t value) override { writer.Int64(value); sum += static_cast<double>(value); return true; }
+        bool Double(double value) override { writer.Double(value); sum += value; return true; }
+        bool Bool(bool value) override { writer.Bool(value); return true; }
+        bool Null() override { writer.Null(); return stopAtNull ? false : true; }
+
+        JsonWriter writer;
+        double sum = 0;
+        bool stopAtNull = false;
+    };
+}
+
+TEST(SerializationTest, JsonParserHandlerEvents) {
+    std::string str = R"({"a":[1,2.5,{"b":"c\n"}],"d":true,"e":null,"f":4})";
+    EchoHandler handler;
+    EXPECT_TRUE(JsonParser(str).Parse(handler));
+    EXPECT_EQ(handler.writer.GetString(), str);
+    EXPECT_EQ(handler.sum, 7.5);
+
+    EchoHandler stopping;
+    stopping.stopAtNull = true;
+    EXPECT_FALSE(JsonParser(str).Parse(stopping));
+    EXPECT_EQ(stopping.writer.GetString(), R"({"a":[1,2.5,{"b":"c\n"}],"d":true,"e":null)");
+    EXPECT_EQ(stopping.sum, 3.5);
+
+    JsonHandler ignoreAll;
+    EXPECT_TRUE(JsonParser(str).Parse(ignoreAll));
+    EXPECT_THROW(JsonParser("[1,]").Parse(ignoreAll), std::logic_error);
+}
+
+TEST(SerializationTest, JsonPushParserChunks) {
+    std::string str = R"({"name":"xu\u00e9\"ranus","list":[1,-2.5e3,true,false,null],"obj":{}} {"next":1})";
+    std::string expected = JsonParser(str.substr(0, str.find(' '))).Parse().Serialize();
+    // every split point, including the middle of strings, escapes, numbers and literals
+    for (std::size_t chunkSize = 1; chunkSize <= 7; ++chunkSize) {
+        JsonPushParser parser;
+        JsonPushParser::Status status = JsonPushParser::Status::NEED_MORE;
+        std::size_t fed = 0;
+        while (status == JsonPushParser::Status::NEED_MORE) {
+            status = parser.Feed(str.substr(fed, chunkSize));
+            fed += chunkSize;
+        }
+        EXPECT_EQ(status, JsonPushParser::Status::COMPLETE);
+        EXPECT_EQ(parser.Consumed(), str.find(' '));
+        EXPECT_EQ(parser.Result().Serialize(), expected);
+        parser.Reset();
+        EXPECT_EQ(parser.Feed(str.substr(str.find(' '))), JsonPushParser::Status::COMPLETE);
+        EXPECT_EQ(parser.Result().AsJsonObject()["next"].AsLongInt(), 1);
+    }
+
+    JsonPushParser number;
+    EXPECT_EQ(number.Feed("12", 2), JsonPushParser::Status::NEED_MORE);
+    EXPECT_EQ(number.Feed("34", 2), JsonPushParser::Status::NEED_MORE);
+    EXPECT_EQ(number.Finish(), JsonPushParser::Status::COMPLETE);
+    EXPECT_EQ(number.Result().AsLongInt(), 1234);
+
+    EchoHandler handler;
+    handler.stopAtNull = true;
+    JsonPushParser stopping(handler);
+    EXPECT_EQ(stopping.Feed("[1, nu"), JsonPushParser::Status::NEED_MORE);
+    EXPECT_EQ(stopping.Feed("ll, 2]"), JsonPushParser::Status::STOPPED);
+    EXPECT_EQ(handler.writer.GetString(), "[1,null");
+
+    JsonPushParser invalid;
+    EXPECT_THROW(invalid.Feed("[1,]"), std::logic_error);
+    JsonPushParser truncated;
+    EXPECT_EQ(truncated.Feed("{\"a\":"), JsonPushParser::Status::NEED_MORE);
+    EXPECT_THROW(truncated.Finish(), std::logic_error);
+
+    const std::size_t depth = 30000;
+    JsonPushParser deep;
+    EXPECT_THROW(deep.Feed(std::string(depth, '[') + std::string(depth, ']')), std::logic_error);
+    const std::size_t maxDepth = JsonParser::MAX_DEPTH;
+    JsonPushParser deepest;
+    EXPECT_EQ(deepest.Feed(std::string(maxDepth, '[')), JsonPushParser::Status::NEED_MORE);
+    EXPECT_EQ(deepest.Feed(std::string(maxDepth, ']')), JsonPushParser::Status::COMPLETE);
+}
+
+TEST(SerializationTest, JsonLinesReaderBatches) {
+    std::string lines;
+    std::vector<std::size_t> offsets;
+    for (int i = 0; i < 5000; ++i) {
+        offsets.push_back(lines.size());
+        lines += R"({"id":)" + std::to_string(i) + R"(,"tags":["a","b"],"text":"line\nbreak"})" + (i % 7 == 0 ? "\r\n" : "\n");
+        if (i % 100 == 0) {
+            lines += "\n"; // blank lines are skipped
+        }
+    }
+    JsonLinesReader reader(4);
+    reader.SetBatchSize(4096);
+    std::vector<std::size_t> seen;
+    std::size_t count = reader.Read(lines.data(), lines.size(), [&](std::size_t offset, JsonElement& record) {
+        EXPECT_EQ(record.AsJsonObject()["id"].AsLongInt(), static_cast<int64_t>(seen.size()));
+        seen.push_back(offset);
+    });
+    EXPECT_EQ(count, 5000);
+    EXPECT_EQ(seen, offsets);
+
+    reader.SetOrdered(false);
+    std::istringstream stream(lines);
+    int64_t sum = 0;
+    EXPECT_EQ(reader.Read(stream, [&](std::size_t, JsonElement& record) {
+        sum += record.AsJsonObject()["id"].AsLongInt();
+    }), 5000);
+    EXPECT_EQ(sum, 4999 * 5000 / 2);
+
+    std::string invalid = lines + "{\"id\":}\n" + lines;
+    EXPECT_THROW(reader.Read(invalid.data(), invalid.size(), [](std::size_t, JsonElement&) {}), std::logic_error);
+}
+
+TEST(SerializationTest, ParseParallelTopLevelArray) {
+    std::string str = " [";
+    for (int i = 0; i < 20000; ++i) {
+        str += i == 0 ? "" : ",";
+        str += R"({"id":)" + std::to_string(i) + R"(,"text":"],[{,\"}","list":[1,[2,{}]]})";
+        str += i % 3 == 0 ? "\n" : "";
+    }
+    str += "] ";
+    JsonParser parser(str);
+    std::string expected = parser.Parse().Serialize();
+    EXPECT_EQ(parser.ParseParallel(4).Serialize(), expected);
+    EXPECT_EQ(parser.ParseParallel(4).AsJsonArray().size(), 20000);
+
+    std::string invalid = str.substr(0, str.size() / 2) + ",," + str.substr(str.size() / 2);
+    std::string sequentialError;
+    try {
+        JsonParser(invalid).Parse();
+    } catch (const std::logic_error& e) {
+        sequentialError = e.what();
+    }
+    EXPECT_FALSE(sequentialError.empty());
+    try {
+        JsonParser(invalid).ParseParallel(4);
+        FAIL();
+    } catch (const std::logic_error& e) {
+        EXPECT_EQ(sequentialError, e.what());
+    }
+    EXPECT_THROW(JsonParser(str + "1").ParseParallel(4), std::logic_error);
+}
+
+TEST(SerializationTest, JsonLazyElementAccess) {
+    std::string str = R"( {
+        "skip": {"a": [1, "]}\"", {"b": null}], "c": "{["},
+        "user": {"name": "xu\u00e9", "age": 300, "score": 99.5, "admin": false, "tags": ["x", "y", "z"]},
+        "esc\u0061ped": 1,
+        "user": "duplicate"
+    } )";
+    JsonLazyElement root(str);
+    EXPECT_TRUE(root.IsJsonObject());
+    EXPECT_EQ(root.Size(), 4);
+    JsonLazyElement user = root["user"];
+    EXPECT_EQ(user["name"].ToString(), "xu\xC3\xA9");
+    EXPECT_EQ(user["age"].ToLongInt(), 300);
+    EXPECT_TRUE(user["age"].IsLongInt());
+    EXPECT_EQ(user["score"].ToDouble(), 99.5);
+    EXPECT_FALSE(user["admin"].ToBool());
+    EXPECT_EQ(user["tags"].Size(), 3);
+    EXPECT_EQ(user["tags"][2].ToString(), "z");
+    EXPECT_EQ(root["escaped"].ToLongInt(), 1);
+    EXPECT_EQ(std::string(root["skip"]["a"].Data(), root["skip"]["a"].Length()), R"([1, "]}\"", {"b": null}])");
+    EXPECT_TRUE(root["skip"]["a"][2]["b"].IsNull());
+    EXPECT_EQ(root["skip"].Materialize().Serialize(), R"({"a":[1,"]}\"",{"b":null}],"c":"{["})");
+
+    JsonLazyElement missing;
+    EXPECT_FALSE(root.Find("none", missing));
+    EXPECT_THROW(root["none"], std::logic_error);
+    EXPECT_THROW(user["tags"][3], std::logic_error);
+    EXPECT_THROW(user["age"]["x"], std::logic_error);
+    // malformed text is only reported when it is reached
+    std::string truncatedStr = R"({"a": 1, "b": [1, 2)";
+    JsonLazyElement truncated(truncatedStr);
+    EXPECT_EQ(truncated["a"].ToLongInt(), 1);
+    EXPECT_THROW(truncated["b"], std::logic_error);
+    std::string numbers = "[7.9, 1e300]";
+    EXPECT_EQ(JsonLazyElement(numbers)[0].ToLongInt(), 7);
+    EXPECT_THROW(JsonLazyElement(numbers)[1].ToLongInt(), std::logic_error);
+}
+
+TEST(SerializationTest, JsonLazyElementRejectsMalformedLiterals) {
+    std::string str = R"({"t": txyz, "n": nope, "f": falsey, "ok": [true, false, null]})";
+    JsonLazyElement root(str);
+    EXPECT_THROW(root["t"].ToBool(), std::logic_error);
+    EXPECT_THROW(root["t"].IsBool(), std::logic_error);
+    EXPECT_THROW(root["n"].IsNull(), std::logic_error);
+    EXPECT_THROW(root["f"].ToBool(), std::logic_error);
+    EXPECT_TRUE(root["ok"][0].ToBool());
+    EXPECT_FALSE(root["ok"][1].ToBool());
+    EXPECT_TRUE(root["ok"][2].IsNull());
+
+}
+
+TEST(SerializationTest, JsonPathQuery) {
+    std::string str = R"({
+        "store": {"book": [
+            {"title": "a", "price": 8.95, "tags": ["x"]},
+            {"title": "b", "price": 12.99},
+            {"title": "c", "price": 8.99},
+            {"title": "d", "price": 22.99}
+        ]},
+        "a/b": 1, "m~n": 2, "": 3, "10": 4, "a:b": 5, "*": 6,
+        "skipped": [[[{"deep": "]}"}]]]
+    })";
+    auto pointer = [&](const std::string& path) {
+        std::vector<JsonElement> results = JsonPath::Pointer(path).Evaluate(str);
+        return results.size() == 1 ? results[0].Serialize() : std::to_string(results.size()) + " results";
+    };
+    EXPECT_EQ(pointer("/store/book/1/title"), R"("b")");
+    EXPECT_EQ(pointer("/store/book/0/tags"), R"(["x"])");
+    EXPECT_EQ(pointer("/a~1b"), "1");
+    EXPECT_EQ(pointer("/m~0n"), "2");
+    EXPECT_EQ(pointer("/"), "3");
+    EXPECT_EQ(pointer("/10"), "4");
+    EXPECT_EQ(pointer("/skipped/0/0/0/deep"), R"("]}")");
+    EXPECT_EQ(pointer("/store/book/4"), "0 results");
+    EXPECT_EQ(pointer("/store/book/01"), "0 results");
+    EXPECT_EQ(pointer("/store/book/*"), "0 results");
+    EXPECT_EQ(JsonPath::Pointer("").Evaluate(str).size(), 1);
+
+    auto titles = [&](const std::string& path) {
+        std::string res;
+        for (JsonElement& element: JsonPath::Compile(path).Evaluate(str)) {
+            res += element.Serialize();
+        }
+        return res;
+    };
+    EXPECT_EQ(titles("/store/book/*/title"), R"("a""b""c""d")");
+    EXPECT_EQ(titles("/store/book/1:3/title"), R"("b""c")");
+    EXPECT_EQ(titles("/store/book/2:/price"), "8.9922.99");
+    EXPECT_EQ(titles("/store/book/:1/title"), R"("a")");
+    EXPECT_EQ(titles("/*/book/0/title"), R"("a")");
+    EXPECT_EQ(titles("/a~3b"), "5");
+    EXPECT_EQ(titles("/~2"), "6");
+    EXPECT_EQ(titles("/a~1b"), "1");
+    EXPECT_EQ(pointer("/a:b"), "5");
+    EXPECT_EQ(pointer("/*"), "6");
+    EXPECT_THROW(JsonPath::Compile("/a:b"), std::logic_error);
+    EXPECT_THROW(JsonPath::Pointer("/a~3b"), std::logic_error);
+
+    EXPECT_THROW(JsonPath::Pointer("a/b"), std::logic_error);
+    EXPECT_THROW(JsonPath::Pointer("/a~2"), std::logic_error);
+    EXPECT_THROW(JsonPath::Compile("/x:y"), std::logic_error);
+}
+
+TEST(SerializationTest, ValidateWithoutAllocation) {
+    std::string str = R"({"list": [1, -2.5e3, "a\u00e9\ud83d\ude00", {"b": [true, false, null]}], "c": {}})";
+    JsonParser parser(str);
+    JsonError error;
+    std::size_t before = g_allocationCount;
+    EXPECT_TRUE(parser.Validate(error));
+    EXPECT_TRUE(parser.IsValid());
+    EXPECT_EQ(g_allocationCount, before);
+    EXPECT_EQ(error.code, JsonErrorCode::NONE);
+
+    auto check = [](const std::string& input, JsonErrorCode code, std::size_t offset) {
+        JsonError err;
+        EXPECT_FALSE(JsonParser(input).Validate(err));
+        EXPECT_EQ(err.code, code) << input << ": " << err.Reason();
+        EXPECT_EQ(err.offset, offset) << input;
+    };
+    check("", JsonErrorCode::EXPECT_VALUE, 0);
+    check("[1,]", JsonErrorCode::EXPECT_VALUE, 3);
+    check("[1 2]", JsonErrorCode::EXPECT_COMMA_OR_END, 3);
+    check(R"({"a" 1})", JsonErrorCode::EXPECT_COLON, 5);
+    check("{1:2}", JsonErrorCode::EXPECT_KEY, 1);
+    check(R"({"a":1])", JsonErrorCode::EXPECT_COMMA_OR_END, 6);
+    check("[tru]", JsonErrorCode::INVALID_LITERAL, 1);
+    check("[1e+]", JsonErrorCode::INVALID_NUMBER, 1);
+    check(R"(["\x"])", JsonErrorCode::INVALID_ESCAPE, 2);
+    check(R"(["\ud83d"])", JsonErrorCode::INVALID_ESCAPE, 2);
+    check(R"(["abc)", JsonErrorCode::MISSING_QUOTE, 1);
+    check("[@]", JsonErrorCode::INVALID_TOKEN, 1);
+    check("[1] 2", JsonErrorCode::TRAILING_CONTENT, 4);
+
+    check("[1,", JsonErrorCode::UNEXPECTED_END, 3);
+    check(R"({"a")", JsonErrorCode::UNEXPECTED_END, 4);
+    check(R"({"a":1)", JsonErrorCode::UNEXPECTED_END, 6);
+    check("[[", JsonErrorCode::UNEXPECTED_END, 2);
+
+    const std::size_t maxDepth = JsonParser::MAX_DEPTH;
+    std::string deep = std::string(maxDepth, '[') + std::string(maxDepth, ']');
+    EXPECT_TRUE(JsonParser(deep).IsValid());
+    EXPECT_FALSE(JsonParser(deep + "]").IsValid());
+    check("[" + deep + "]", JsonErrorCode::DEPTH_EXCEEDED, maxDepth);
+}
+
+TEST(SerializationTest, TryParseReportsErrors) {
+    JsonElement element;
+    JsonError error;
+    EXPECT_TRUE(JsonParser(R"({"a": [1, 2]})").TryParse(element, error));
+    EXPECT_EQ(element.Serialize(), R"({"a":[1,2]})");
+
+    std::string str = "{\n  \"a\": [1, 2],\n  \"b\": tru\n}";
+    JsonElement untouched(true);
+    EXPECT_FALSE(JsonParser(str).TryParse(untouched, error));
+    EXPECT_TRUE(untouched.AsBool());
+    EXPECT_EQ(error.code, JsonErrorCode::INVALID_LITERAL);
+    EXPECT_EQ(error.offset, str.find("tru"));
+    std::size_t line = 0;
+    std::size_t column = 0;
+    error.Locate(str.data(), line, column);
+    EXPECT_EQ(line, 3);
+    EXPECT_EQ(column, 8);
+    EXPECT_THROW(JsonParser(str).Parse(), std::logic_error);
+}
+
+TEST(SerializationTest, TryParseRejectsDeepNesting) {
+    const std::size_t depth = 200000;
+    std::string hostile = std::string(depth, '[') + std::string(depth, ']');
+    JsonElement element;
+    JsonError error;
+    EXPECT_FALSE(JsonParser(hostile).TryParse(element, error));
+    EXPECT_EQ(error.code, JsonErrorCode::DEPTH_EXCEEDED);
+    EXPECT_THROW(JsonParser(hostile).Parse(), std::logic_error);
+
+    const std::size_t maxDepth = JsonParser::MAX_DEPTH;
+    std::string deepest = std::string(maxDepth, '[') + std::string(maxDepth, ']');
+    EXPECT_TRUE(JsonParser(deepest).TryParse(element, error));
+    EXPECT_TRUE(element.IsJsonArray());
+}
+
+TEST(SerializationTest, ShortStringsStayInline) {
+    EXPECT_EQ(sizeof(JsonElement), 16);
+    JsonElement shortString(std::string("fourteen chars"));
+    std::size_t before = g_allocationCount;
+    JsonElement copy = shortString;
+    JsonElement moved = std::move(copy);
+    EXPECT_EQ(g_allocationCount, before);
+    EXPECT_EQ(moved.ToString(), "fourteen chars");
+    EXPECT_EQ(moved.Serialize(), R"("fourteen chars")");
+
+    // a std::string reference needs a heap string, mutations are kept
+    moved.AsString() += " and more";
+    EXPECT_EQ(moved.ToString(), "fourteen chars and more");
+    EXPECT_EQ(shortString.ToString(), "fourteen chars");
+    JsonElement longCopy = moved;
+    EXPECT_EQ(longCopy.ToString(), moved.ToString());
+
+    std::string str = "[";
+    for (int i = 0; i < 100; ++i) {
+        str += std::string(i == 0 ? "" : ",") + "\"key" + std::to_string(i) + "\"";
+    }
+    str += "]";
+    JsonParser parser(str);
+    before = g_allocationCount;
+    JsonElement array = parser.Parse();
+    // the array storage grows a few times, no string is allocated
+    EXPECT_LT(g_allocationCount - before, 20);
+    EXPECT_EQ(array.AsJsonArray()[42].ToString(), "key42");
 }
 
 TEST(SerializationTest, BasicStructSerialization) {
@@ -209,3 +989,246 @@ TEST(SerializationTest, NestedStructSerialization) {
 }
 
 
+
+TEST(SerializationTest, DeserializeFromTokens) {
+    std::string jsonStr = R"({
+        "unknown" : {"nested" : [1, {"a" : null}, "]"]},
+        "tags" : ["C++", "Programming"],
+        "id" : 114.9,
+        "price" : 20,
+        "pageWithPic" : [[1, 2], [3], [4, 5, 6]],
+        "soldOut" : true,
+        "extra" : [true, false]
+    })";
+    Book book {};
+    book.m_name = "untouched";
+    util::Deserialize(jsonStr, book);
+    EXPECT_EQ(book.m_name, "untouched");
+    EXPECT_EQ(book.m_id, 114);
+    EXPECT_EQ(book.m_currentPrice, 20.0f);
+    EXPECT_TRUE(book.m_soldOut);
+    EXPECT_EQ(book.m_tags, std::vector<std::string>({ "C++", "Programming" }));
+    EXPECT_EQ(book.m_pageWithPic.size(), 3);
+    EXPECT_EQ(book.m_pageWithPic[0], std::make_pair(1u, 2u));
+    EXPECT_EQ(book.m_pageWithPic[1], std::make_pair(0u, 0u));
+    EXPECT_EQ(book.m_pageWithPic[2], std::make_pair(4u, 5u));
+
+    // numbers convert across long and double on the JsonElement path as well
+    EXPECT_EQ(JsonElement(114.9).ToLongInt(), 114);
+    EXPECT_EQ(JsonElement(-9223372036854775808.0).ToLongInt(), INT64_MIN);
+    EXPECT_THROW(JsonElement(9223372036854775808.0).ToLongInt(), std::logic_error);
+    EXPECT_THROW(JsonElement(std::nan("")).ToLongInt(), std::logic_error);
+    EXPECT_EQ(JsonElement(static_cast<int64_t>(20)).ToDouble(), 20.0);
+    EXPECT_THROW(util::Deserialize(std::string(R"({"id":1e300})"), book), std::logic_error);
+
+    Author author {};
+    author.m_name = "author";
+    author.m_books = { book, book };
+    std::string authorStr = util::Serialize(author);
+    std::size_t before = g_allocationCount;
+    Author copied {};
+    util::Deserialize(authorStr, copied);
+    std::size_t readAllocations = g_allocationCount - before;
+    before = g_allocationCount;
+    JsonElement element = JsonParser(authorStr).Parse();
+    std::size_t parseAllocations = g_allocationCount - before;
+    EXPECT_LT(readAllocations, parseAllocations);
+    EXPECT_EQ(util::Serialize(copied), authorStr);
+
+    EXPECT_THROW(util::Deserialize(std::string(R"({"id":1,})"), book), std::logic_error);
+    EXPECT_THROW(util::Deserialize(std::string(R"({"id":"1"})"), book), std::logic_error);
+    EXPECT_THROW(util::Deserialize(std::string(R"({"id":1} 2)"), book), std::logic_error);
+    EXPECT_THROW(util::Deserialize(std::string(R"([])"), book), std::logic_error);
+
+    // an unknown member is skipped without recursing past the parser's depth limit
+    const std::size_t depth = 100000;
+    std::string deep = R"({"id":1,"unknown":)" + std::string(depth, '[') + std::string(depth, ']') + "}";
+    EXPECT_THROW(util::Deserialize(deep, book), std::logic_error);
+    const std::size_t maxDepth = JsonParser::MAX_DEPTH;
+    std::string deepest = R"({"id":2,"unknown":)" + std::string(maxDepth - 1, '[') + std::string(maxDepth - 1, ']') + "}";
+    util::Deserialize(deepest, book);
+    EXPECT_EQ(book.m_id, 2);
+}
+
+TEST(SerializationTest, JsonReaderPull) {
+    std::string jsonStr = R"( {"a" : [1, 2.5, "x", null, {}], "b" : false} )";
+    JsonReader reader(jsonStr);
+    std::string key;
+    EXPECT_EQ(reader.PeekType(), JsonElement::Type::JSON_OBJECT);
+    reader.StartObject();
+    EXPECT_TRUE(reader.NextMember(key));
+    EXPECT_EQ(key, "a");
+    reader.StartArray();
+    EXPECT_TRUE(reader.NextElement());
+    EXPECT_EQ(reader.PeekType(), JsonElement::Type::JSON_NUMBER_LONG);
+    EXPECT_EQ(reader.ReadLongInt(), 1);
+    EXPECT_TRUE(reader.NextElement());
+    EXPECT_EQ(reader.PeekType(), JsonElement::Type::JSON_NUMBER_DOUBLE);
+    EXPECT_EQ(reader.ReadDouble(), 2.5);
+    EXPECT_TRUE(reader.NextElement());
+    EXPECT_EQ(reader.ReadString(), "x");
+    EXPECT_TRUE(reader.NextElement());
+    reader.ReadNull();
+    EXPECT_TRUE(reader.NextElement());
+    reader.SkipValue();
+    EXPECT_FALSE(reader.NextElement());
+    EXPECT_TRUE(reader.NextMember(key));
+    EXPECT_EQ(key, "b");
+    EXPECT_FALSE(reader.ReadBool());
+    EXPECT_FALSE(reader.NextMember(key));
+    reader.Finish();
+
+    std::string malformed = R"([1 2])";
+    JsonReader badReader(malformed);
+    badReader.StartArray();
+    EXPECT_TRUE(badReader.NextElement());
+    EXPECT_EQ(badReader.ReadLongInt(), 1);
+    EXPECT_THROW(badReader.NextElement(), std::logic_error);
+}
+
+namespace {
+    struct Inventory {
+        std::map<std::string, int> m_counts;
+        std::pair<int, double> m_range;
+        std::list<Book> m_books;
+        double m_ratio;
+
+        SERIALIZE_SECTION_BEGIN
+        SERIALIZE_FIELD(counts, m_counts);
+        SERIALIZE_FIELD(range, m_range);
+        SERIALIZE_FIELD(books, m_books);
+        SERIALIZE_FIELD(ratio, m_ratio);
+        SERIALIZE_SECTION_END
+    };
+}
+
+TEST(SerializationTest, SerializeToWriter) {
+    Book book {};
+    book.m_name = "C++ \"Primer\"";
+    book.m_id = -3;
+    book.m_currentPrice = 11.4f;
+    book.m_tags = { "C++" };
+    book.m_pageWithPic = { { 1, 2 } };
+    Inventory inventory {};
+    inventory.m_counts = { { "b", 2 }, { "a", 1 } };
+    inventory.m_range = { 7, 0.25 };
+    inventory.m_books = { book, book };
+    inventory.m_ratio = 1e-9;
+
+    // same text as the JsonObject path
+    JsonObject object;
+    inventory._XURANUS_JSON_CPP_SERIALIZE_METHOD_(object, true);
+    std::string expected = object.Serialize();
+    // the first call builds the field tables of the types
+    util::Serialize(inventory);
+    std::size_t before = g_allocationCount;
+    std::string jsonStr = util::Serialize(inventory);
+    EXPECT_LT(g_allocationCount - before, 8);
+    EXPECT_EQ(jsonStr, expected);
+    EXPECT_EQ(jsonStr.substr(0, 41), R"({"counts":{"a":1,"b":2},"range":[7,0.25],)");
+
+    JsonWriter writer;
+    writer.StartArray();
+    util::Serialize(book, writer);
+    util::Serialize(inventory, writer);
+    writer.EndArray();
+    EXPECT_EQ(writer.GetString(), "[" + util::Serialize(book) + "," + jsonStr + "]");
+
+    Inventory copied {};
+    util::Deserialize(jsonStr, copied);
+    EXPECT_EQ(util::Serialize(copied), jsonStr);
+}
+
+namespace {
+    struct WideRecord {
+        int m_f0 = -1;
+        int m_f1 = -1;
+        int m_f2 = -1;
+        int m_f3 = -1;
+        int m_f4 = -1;
+        int m_f5 = -1;
+        int m_f6 = -1;
+        int m_f7 = -1;
+        int m_f8 = -1;
+        int m_f9 = -1;
+        std::string m_name;
+        std::string m_alias;
+
+        SERIALIZE_SECTION_BEGIN
+        SERIALIZE_FIELD(f0, m_f0);
+        SERIALIZE_FIELD(f1, m_f1);
+        SERIALIZE_FIELD(f2, m_f2);
+        SERIALIZE_FIELD(f3, m_f3);
+        SERIALIZE_FIELD(f4, m_f4);
+        SERIALIZE_FIELD(f5, m_f5);
+        SERIALIZE_FIELD(f6, m_f6);
+        SERIALIZE_FIELD(f7, m_f7);
+        SERIALIZE_FIELD(f8, m_f8);
+        SERIALIZE_FIELD(f9, m_f9);
+        SERIALIZE_FIELD(name, m_name);
+        SERIALIZE_FIELD(name, m_alias);
+        SERIALIZE_SECTION_END
+    };
+
+    // a static field has no offset in the object and is read through the visitor instead
+    struct SharedLimit {
+        static int s_limit;
+        int m_used = 0;
+
+        SERIALIZE_SECTION_BEGIN
+        SERIALIZE_FIELD(limit, s_limit);
+        SERIALIZE_FIELD(used, m_used);
+        SERIALIZE_SECTION_END
+    };
+
+    int SharedLimit::s_limit = 0;
+}
+
+TEST(SerializationTest, FieldTableDispatch) {
+    JsonFieldTable table;
+    table.Add("a");
+    table.Add("b");
+    table.Add("a");
+    EXPECT_EQ(table.Size(), 3);
+    EXPECT_EQ(table.Find("b", 1), 1);
+    EXPECT_EQ(table.Find("a", 2), 0);
+    EXPECT_TRUE(table.Find("c", 0) == JsonFieldTable::NO_FIELD);
+
+    // out of order, unknown, missing and repeated keys on the hashed table
+    WideRecord record;
+    util::Deserialize(std::string(R"({"f9":9,"f1":1,"x":{"f2":2},"f2":2,"name":"n","f3":3})"), record);
+    EXPECT_EQ(record.m_f0, -1);
+    EXPECT_EQ(record.m_f1, 1);
+    EXPECT_EQ(record.m_f2, 2);
+    EXPECT_EQ(record.m_f3, 3);
+    EXPECT_EQ(record.m_f4, -1);
+    EXPECT_EQ(record.m_f9, 9);
+    EXPECT_EQ(record.m_name, "n");
+    EXPECT_EQ(record.m_alias, "");
+
+    // a repeated key is written once with the value of its last field, the same text as the JsonObject path
+    record.m_alias = "alias";
+    JsonObject fields;
+    record._XURANUS_JSON_CPP_SERIALIZE_METHOD_(fields, true);
+    std::string serialized = util::Serialize(record);
+    EXPECT_EQ(serialized, JsonElement(fields).Serialize());
+    EXPECT_EQ(serialized.find("\"name\"", serialized.find("\"name\"") + 1), std::string::npos);
+    WideRecord copied;
+    util::Deserialize(serialized, copied);
+    EXPECT_EQ(copied.m_f3, 3);
+    EXPECT_EQ(copied.m_f4, -1);
+    EXPECT_EQ(copied.m_name, "alias");
+
+    SharedLimit limit;
+    util::Deserialize(std::string(R"({"used":3,"limit":10})"), limit);
+    EXPECT_EQ(limit.m_used, 3);
+    EXPECT_EQ(SharedLimit::s_limit, 10);
+
+    // the JsonObject path leaves missing fields untouched as well
+    Book book {};
+    book.m_name = "untouched";
+    JsonObject object = JsonParser(std::string(R"({"id":7})")).Parse().AsJsonObject();
+    book._XURANUS_JSON_CPP_SERIALIZE_METHOD_(object, false);
+    EXPECT_EQ(book.m_id, 7);
+    EXPECT_EQ(book.m_name, "untouched");
+}